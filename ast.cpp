@@ -0,0 +1,170 @@
+#include "ast.h"
+#include <string>
+
+namespace {
+
+// Source spelling of an operator or type
+const char* opSpelling(TokenType type) {
+    switch (type) {
+        case TokenType::INT: return "int";
+        case TokenType::FLOAT: return "float";
+        case TokenType::PLUS: return "+";
+        case TokenType::MINUS: return "-";
+        case TokenType::MULTIPLY: return "*";
+        case TokenType::DIVIDE: return "/";
+        case TokenType::INCREMENT: return "++";
+        case TokenType::DECREMENT: return "--";
+        case TokenType::LESS_THAN: return "<";
+        case TokenType::GREATER_THAN: return ">";
+        default: return "?";
+    }
+}
+
+} // namespace
+
+// Constructor
+Ast::Ast() : keepSpans(false), root(npos) {}
+
+// Append a node
+uint32_t Ast::add(AstKind kind, uint32_t first, uint32_t second, TokenType op) {
+    AstNode node;
+    node.kind = kind;
+    node.opType = static_cast<uint8_t>(op);
+    node.prefix = false;
+    node.first = first;
+    node.second = second;
+    node.next = npos;
+    nodes.push_back(node);
+    if (keepSpans) {
+        spans.push_back(AstSpan());
+    }
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+// Append another tree's nodes
+uint32_t Ast::append(const Ast& other) {
+    uint32_t base = static_cast<uint32_t>(nodes.size());
+    auto move = [base](uint32_t& index) {
+        if (index != npos) index += base;
+    };
+    
+    nodes.reserve(nodes.size() + other.nodes.size());
+    for (AstNode node : other.nodes) {
+        // Leaves hold ids and offsets rather than children
+        if (node.kind != AstKind::IDENTIFIER && node.kind != AstKind::CONSTANT) {
+            move(node.first);
+            move(node.second);
+            move(node.next);
+        }
+        nodes.push_back(node);
+    }
+    if (keepSpans) {
+        if (other.keepSpans) {
+            spans.insert(spans.end(), other.spans.begin(), other.spans.end());
+        } else {
+            spans.resize(nodes.size());
+        }
+    }
+    return base;
+}
+
+// Keep spans for new nodes
+void Ast::setKeepSpans(bool enabled) {
+    keepSpans = enabled;
+    spans.resize(enabled ? nodes.size() : 0);
+}
+
+// Get the root
+uint32_t Ast::getRoot() const {
+    return root;
+}
+
+// Set the root
+void Ast::setRoot(uint32_t index) {
+    root = index;
+}
+
+// Number of nodes
+size_t Ast::size() const {
+    return nodes.size();
+}
+
+// Bytes held by the nodes
+size_t Ast::memoryUsage() const {
+    return nodes.capacity() * sizeof(AstNode) + spans.capacity() * sizeof(AstSpan);
+}
+
+// Reserve node space
+void Ast::reserve(size_t count) {
+    nodes.reserve(count);
+    if (keepSpans) {
+        spans.reserve(count);
+    }
+}
+
+// Free every node
+void Ast::clear() {
+    std::vector<AstNode>().swap(nodes);
+    std::vector<AstSpan>().swap(spans);
+    root = npos;
+}
+
+// Print the whole tree
+void Ast::print(std::ostream& out, const Interner& names, const ConstantPool& constants) const {
+    if (root == npos) {
+        out << "(no tree)\n";
+        return;
+    }
+    printNode(out, root, 0, names, constants);
+}
+
+// Print one node, its children, and the statements chained after it
+void Ast::printNode(std::ostream& out, uint32_t index, int depth,
+                    const Interner& names, const ConstantPool& constants) const {
+    for (; index != npos; index = nodes[index].next) {
+        const AstNode& node = nodes[index];
+        out << std::string(depth * 2, ' ');
+        
+        switch (node.kind) {
+            case AstKind::PROGRAM:
+                out << "Program\n";
+                printNode(out, node.first, depth + 1, names, constants);
+                break;
+            case AstKind::DECL:
+                out << "Decl " << opSpelling(node.op()) << " " << names.name(nodes[node.first].first) << "\n";
+                if (node.second != npos) printNode(out, node.second, depth + 1, names, constants);
+                break;
+            case AstKind::ASSIGN:
+                out << "Assign " << names.name(nodes[node.first].first) << "\n";
+                printNode(out, node.second, depth + 1, names, constants);
+                break;
+            case AstKind::UNARY:
+                out << "Unary " << (node.prefix ? opSpelling(node.op()) : "")
+                    << names.name(nodes[node.first].first) << (node.prefix ? "" : opSpelling(node.op())) << "\n";
+                break;
+            case AstKind::WHILE:
+                out << "While\n";
+                printNode(out, node.first, depth + 1, names, constants);
+                printNode(out, node.second, depth + 1, names, constants);
+                break;
+            case AstKind::COND:
+            case AstKind::BINARY_EXPR:
+                out << (node.kind == AstKind::COND ? "Cond " : "BinaryExpr ") << opSpelling(node.op()) << "\n";
+                printNode(out, node.first, depth + 1, names, constants);
+                printNode(out, node.second, depth + 1, names, constants);
+                break;
+            case AstKind::IDENTIFIER:
+                out << "Identifier " << names.name(node.first) << "\n";
+                break;
+            case AstKind::CONSTANT:
+                if (node.first == ConstantPool::npos) {
+                    out << "Constant (out of range)\n";
+                } else if (constants.isFloat(node.first)) {
+                    out << "Constant " << constants.floatValue(node.first) << "\n";
+                } else {
+                    out << "Constant " << constants.integerValue(node.first) << "\n";
+                }
+                break;
+        }
+    }
+}
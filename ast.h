@@ -0,0 +1,118 @@
+#ifndef AST_H
+#define AST_H
+
+#include "lexer.h"
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Kinds of AST node
+enum class AstKind : uint8_t {
+    PROGRAM, DECL, ASSIGN, UNARY, WHILE, COND, BINARY_EXPR, IDENTIFIER, CONSTANT
+};
+
+// AST node (16 bytes). Children are 32-bit indices into the Ast, and
+// statements are chained through `next`. What the fields hold per kind:
+//
+//   kind         op                 first             second            next
+//   PROGRAM      -                  first statement   -                 -
+//   DECL         INT or FLOAT       IDENTIFIER        initializer       next statement
+//   ASSIGN       -                  IDENTIFIER        expression        next statement
+//   UNARY        INCREMENT/DECR.    IDENTIFIER        -                 next statement
+//   WHILE        -                  COND              first statement   next statement
+//   COND         LESS/GREATER_THAN  left expression   right expression  -
+//   BINARY_EXPR  PLUS..DIVIDE       left operand      right operand     -
+//   IDENTIFIER   -                  interned name id  source offset     -
+//   CONSTANT     -                  constant index    source offset     -
+//
+// Absent children (no initializer, empty body) are Ast::npos. Source
+// offsets are those of the parse that built the node: an incremental
+// reparse keeps old nodes as they are.
+struct AstNode {
+    AstKind kind;
+    uint8_t opType;     // TokenType of the operator or declared type
+    bool prefix;        // UNARY: operator written before the name
+    uint32_t first;
+    uint32_t second;
+    uint32_t next;
+    
+    TokenType op() const { return static_cast<TokenType>(opType); }
+};
+
+static_assert(sizeof(AstNode) == 16, "AstNode should stay 16 bytes");
+
+// Where a node came from, kept for incremental reparsing: the tokens it
+// covers and the parser state it started in. Positions are relative, so an
+// edit only changes the spans of the blocks around it and of the statement
+// after each: a statement starts `offset` tokens after the statement before
+// it in its block (or after the block's '{'), any other node `offset`
+// tokens after the first token of its statement. A statement always starts
+// with `stmts` on top of the stack, and what lies below is fixed by the
+// statement lists around it, so their number is the state.
+struct AstSpan {
+    uint32_t offset;        // First token, relative as above (0 for the Program)
+    uint32_t length;        // Number of tokens
+    uint32_t depth;         // Statement lists open around it (0 for the Program)
+};
+
+// Syntax tree stored in one growing array (a bump arena): nodes are only
+// ever appended, refer to each other by index, and are all freed at once
+// by clear() or the destructor.
+class Ast {
+private:
+    std::vector<AstNode> nodes;
+    std::vector<AstSpan> spans;     // Parallel to nodes when kept
+    bool keepSpans;
+    uint32_t root;
+    
+    // Print a node and the statements chained after it
+    void printNode(std::ostream& out, uint32_t index, int depth,
+                   const Interner& names, const ConstantPool& constants) const;
+    
+public:
+    // Index of no node
+    static constexpr uint32_t npos = UINT32_MAX;
+    
+    // Constructor
+    Ast();
+    
+    // Append a node and return its index (op is TokenType::ERROR for
+    // kinds without an operator)
+    uint32_t add(AstKind kind, uint32_t first, uint32_t second, TokenType op = TokenType::ERROR);
+    
+    // Append every node of another tree, moving its child indices, and
+    // return the index its first node gets. Spans are copied unchanged.
+    uint32_t append(const Ast& other);
+    
+    // Access a node
+    AstNode& node(uint32_t index) { return nodes[index]; }
+    const AstNode& node(uint32_t index) const { return nodes[index]; }
+    
+    // Keep an AstSpan for every node added from now on (off by default;
+    // the parser fills them in)
+    void setKeepSpans(bool enabled);
+    bool hasSpans() const { return keepSpans; }
+    AstSpan& span(uint32_t index) { return spans[index]; }
+    const AstSpan& span(uint32_t index) const { return spans[index]; }
+    
+    // The Program node, or npos if no tree was built
+    uint32_t getRoot() const;
+    void setRoot(uint32_t index);
+    
+    // Number of nodes
+    size_t size() const;
+    
+    // Bytes held by the node and span arrays
+    size_t memoryUsage() const;
+    
+    // Reserve space for a number of nodes
+    void reserve(size_t count);
+    
+    // Free every node
+    void clear();
+    
+    // Write the tree as indented text, one node per line
+    void print(std::ostream& out, const Interner& names, const ConstantPool& constants) const;
+};
+
+#endif // AST_H
@@ -0,0 +1,701 @@
+// Micro-benchmarks for the compiler front end.
+//
+// Usage: benchmark [statements]
+// Built and run by `make bench`.
+
+#include "lexer.h"
+#include "source_buffer.h"
+#include "symbol_table.h"
+#include "error_handler.h"
+#include "grammar.h"
+#include "parser.h"
+#include "rd_parser.h"
+#include "lalr_parser.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Count every heap allocation made by the process
+static size_t allocationCount = 0;
+
+void* operator new(std::size_t size) {
+    allocationCount++;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+// Elapsed seconds since start
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Parser writes its files under output/ and DEBUG lines to stdout, so the
+// parser benchmarks run in a scratch directory with stdout muted.
+// restore() (or the destructor, if the benchmark throws) unmutes stdout,
+// goes back to the previous directory and removes the scratch one.
+class ScratchDirectory {
+private:
+    std::filesystem::path previousDirectory;
+    std::filesystem::path path;
+    std::streambuf* stdoutBuffer;
+    
+public:
+    ScratchDirectory()
+        : previousDirectory(std::filesystem::current_path()),
+          path(std::filesystem::temp_directory_path() / "compiler_bench"), stdoutBuffer(nullptr) {
+        std::filesystem::create_directories(path);
+        std::filesystem::current_path(path);
+        stdoutBuffer = std::cout.rdbuf(nullptr);
+    }
+    
+    ~ScratchDirectory() { restore(); }
+    
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+    
+    void restore() {
+        if (!stdoutBuffer) return;
+        std::cout.rdbuf(stdoutBuffer);
+        stdoutBuffer = nullptr;
+        std::error_code error;
+        std::filesystem::current_path(previousDirectory, error);
+        std::filesystem::remove_all(path, error);
+    }
+};
+
+// Generate a valid program with the given number of statements.
+// Identifiers are longer than the small-string buffer so that any
+// per-token std::string would have to allocate.
+static std::string generateSource(size_t statements) {
+    std::string text = "int main() {\n";
+    text += "    int accumulated_total_value = 0;\n";
+    text += "    int loop_counter_variable = 0;\n";
+    for (size_t i = 0; i < statements; ++i) {
+        switch (i % 4) {
+            case 0:
+                text += "    // running total of the generated values\n";
+                text += "    accumulated_total_value = accumulated_total_value + 12;\n";
+                break;
+            case 1:
+                text += "    loop_counter_variable++;\n";
+                break;
+            case 2:
+                text += "    /* scaled update */ accumulated_total_value = (loop_counter_variable * 3) / 2;\n";
+                break;
+            default:
+                text += "    while (loop_counter_variable < 100) { loop_counter_variable++; }\n";
+                break;
+        }
+    }
+    text += "}\n";
+    return text;
+}
+
+// Generate a valid program of long arithmetic assignments: mostly
+// operators and operands, where the LL(1) parser spends its time going
+// through expr_tail and term_tail
+static std::string generateExpressionSource(size_t statements) {
+    static const char* const operators[] = {" + ", " * ", " - ", " / "};
+    std::string text = "int main() {\n";
+    text += "    int alpha = 1, beta = 2, gamma = 3, delta = 4;\n";
+    for (size_t i = 0; i < statements; ++i) {
+        text += "    alpha = beta";
+        for (size_t k = 0; k < 12; ++k) {
+            text += operators[(i + k) % 4];
+            text += (k % 3 == 2) ? "(gamma - 7)" : (k % 2 ? "delta" : "42");
+        }
+        text += ";\n";
+    }
+    text += "}\n";
+    return text;
+}
+
+// Lexer throughput and allocations per token once buffers are warm
+static void benchLexer(const std::string& text) {
+    auto source = std::make_shared<SourceBuffer>(text);
+    LexicalAnalyzer lexer;
+    
+    // Warm-up run sizes the token vector
+    lexer.tokenizeSource(source);
+    
+    size_t allocationsBefore = allocationCount;
+    auto start = std::chrono::steady_clock::now();
+    lexer.tokenizeSource(source);
+    double seconds = secondsSince(start);
+    size_t allocations = allocationCount - allocationsBefore;
+    
+    size_t tokens = lexer.getTokens().size();
+    size_t tokenBytes = lexer.getTokens().memoryUsage();
+    std::cout << "Lexer (table mode)" << std::endl;
+    std::cout << "  input:            " << text.size() << " bytes, " << tokens << " tokens" << std::endl;
+    std::cout << "  throughput:       " << (text.size() / seconds / 1e6) << " MB/s" << std::endl;
+    std::cout << "  allocations:      " << allocations << " (steady state)" << std::endl;
+    std::cout << "  allocs per token: " << (static_cast<double>(allocations) / tokens) << std::endl;
+    std::cout << "  token memory:     " << (static_cast<double>(tokenBytes) / tokens)
+              << " bytes/token (Token struct: " << sizeof(Token) << ")" << std::endl;
+}
+
+// Sequential vs parallel chunked lexing of the same buffer
+static void benchParallelLexer(const std::string& text) {
+    auto source = std::make_shared<SourceBuffer>(text);
+    unsigned cores = std::max(2u, std::thread::hardware_concurrency());
+    
+    std::cout << "Parallel lexer (" << text.size() << " bytes)" << std::endl;
+    double baseline = 0;
+    for (unsigned threads = 1; threads <= cores; threads *= 2) {
+        LexicalAnalyzer lexer;
+        lexer.setThreadCount(threads, 0);
+        lexer.tokenizeSource(source);  // Warm-up
+        
+        auto start = std::chrono::steady_clock::now();
+        lexer.tokenizeSource(source);
+        double seconds = secondsSince(start);
+        if (threads == 1) baseline = seconds;
+        
+        std::cout << "  " << threads << " thread(s): " << (seconds * 1e3) << " ms, speedup "
+                  << (baseline / seconds) << "x" << std::endl;
+    }
+}
+
+// Re-lexing after a one-character edit vs lexing the whole buffer again
+static void benchEdit(const std::string& text) {
+    LexicalAnalyzer lexer;
+    lexer.tokenizeSource(std::make_shared<SourceBuffer>(text));
+    
+    auto start = std::chrono::steady_clock::now();
+    lexer.tokenizeSource(std::make_shared<SourceBuffer>(text));
+    double full = secondsSince(start);
+    
+    // Type and then delete a character in the middle of an identifier
+    size_t offset = text.find("accumulated_total_value", text.size() / 2) + 5;
+    const int edits = 100;
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < edits; ++i) {
+        lexer.applyEdit(offset, 0, "x");
+        lexer.applyEdit(offset, 1, "");
+    }
+    double perEdit = secondsSince(start) / (2 * edits);
+    
+    std::cout << "Incremental re-lex (" << text.size() << " bytes)" << std::endl;
+    std::cout << "  full lex:         " << (full * 1e3) << " ms" << std::endl;
+    std::cout << "  applyEdit:        " << (perEdit * 1e3) << " ms ("
+              << lexer.getLastEdit().inserted << " token(s) re-lexed)" << std::endl;
+}
+
+// Per-token cost of Parser::parse (table lookups and stack work) at each
+// trace level, and untraced with the binary trace recorder (capturing
+// only, then writing the trace file). With a grammar file, the grammar is
+// loaded from a copy of it instead of built in.
+static void benchParser(const std::string& text, const std::string& grammarFile = "") {
+    std::filesystem::path grammarPath = grammarFile.empty() ? "" : std::filesystem::absolute(grammarFile);
+    ScratchDirectory scratch;
+    
+    auto source = std::make_shared<SourceBuffer>(text);
+    auto grammar = std::make_shared<Grammar>();
+    grammar->initializeGrammar();
+    if (!grammarFile.empty()) {
+        // The copy keeps its .cache out of the source tree
+        std::filesystem::copy_file(grammarPath, grammarPath.filename());
+        grammar->loadFromFile(grammarPath.filename().string());
+        if (!grammar->isCompiled()) {
+            grammar->computeFirstSets();
+            grammar->computeFollowSets();
+        }
+    }
+    
+    const TraceLevel levels[] = {TraceLevel::DEBUG, TraceLevel::STAGES, TraceLevel::NONE, TraceLevel::NONE,
+                                 TraceLevel::NONE};
+    double best[5] = {0, 0, 0, 0, 0};
+    uint64_t records = 0;
+    uint64_t tracedTokens = 0;
+    size_t tokens = 0;
+    bool accepted = false;
+    size_t nodes = 0;
+    size_t treeBytes = 0;
+    auto runOnce = [&](int level, int run) {
+        auto errorHandler = std::make_shared<ErrorHandler>(false);
+        auto symbolTable = std::make_shared<SymbolTable>(errorHandler);
+        auto lexer = std::make_shared<LexicalAnalyzer>(symbolTable, errorHandler);
+        lexer->tokenizeSource(source);
+        tokens = lexer->getTokens().size();
+        
+        Parser parser(lexer, symbolTable, errorHandler, grammar);
+        parser.generateParseTable();
+        parser.setTraceLevel(levels[level]);
+        std::shared_ptr<ParseTraceRecorder> recorder;
+        if (level >= 3) {
+            // A recorder without a file drops each block of records
+            recorder = std::make_shared<ParseTraceRecorder>(level == 3 ? "" : "parse_trace.bin");
+            parser.setTraceRecorder(recorder);
+        }
+        
+        auto start = std::chrono::steady_clock::now();
+        accepted = parser.parse();
+        double seconds = secondsSince(start);
+        if (run == 0 || seconds < best[level]) best[level] = seconds;
+        nodes = parser.getAst().size();
+        treeBytes = parser.getAst().memoryUsage();
+        if (recorder) {
+            records = recorder->size();
+            tracedTokens = recorder->tokenCount();
+        }
+    };
+    
+    // Best of several runs. The untraced ones are short and noisy, so they
+    // take turns: a slow stretch of the machine then hits all three alike.
+    for (int level = 0; level < 2; ++level) {
+        for (int run = 0; run < 3; ++run) {
+            runOnce(level, run);
+        }
+    }
+    for (int run = 0; run < 41; ++run) {
+        for (int level = 2; level < 5; ++level) {
+            runOnce(level, run);
+        }
+    }
+    
+    scratch.restore();
+    
+    std::cout << "Parser" << (grammarFile.empty() ? "" : ", --grammar=" + grammarFile) << " (" << tokens
+              << " tokens" << (accepted ? "" : ", REJECTED") << ")" << std::endl;
+    const char* names[5] = {"trace=debug:      ", "trace=stages:     ", "trace=none:       ",
+                            "binary, no file:  ", "binary trace file:"};
+    for (int level = 0; level < 5; ++level) {
+        std::cout << "  " << names[level] << (best[level] * 1e3) << " ms, "
+                  << (best[level] * 1e9 / tokens) << " ns/token" << std::endl;
+    }
+    std::cout << "  recording cost:   " << ((best[3] / best[2] - 1) * 100) << "% capture, "
+              << ((best[4] / best[2] - 1) * 100) << "% with the file (" << records << " records, "
+              << tracedTokens << " token types, " << ((records * sizeof(TraceRecord) + tracedTokens) / 1024)
+              << " KiB)" << std::endl;
+    std::cout << "  AST:              " << nodes << " nodes, " << (treeBytes / 1024) << " KiB ("
+              << sizeof(AstNode) << " bytes/node)" << std::endl;
+}
+
+// Table-driven Parser::parse, untraced, against the generated
+// recursive-descent parser on the same token streams
+static void benchRecursiveDescent(const std::string& text) {
+    ScratchDirectory scratch;
+    
+    auto source = std::make_shared<SourceBuffer>(text);
+    auto grammar = std::make_shared<Grammar>();
+    grammar->initializeGrammar();
+    
+    // Best of 3 for each engine, each run on a freshly lexed stream
+    double best[2] = {0, 0};
+    bool accepted[2] = {false, false};
+    size_t tokens = 0;
+    for (int run = 0; run < 3; ++run) {
+        for (int engine = 0; engine < 2; ++engine) {
+            auto errorHandler = std::make_shared<ErrorHandler>(false);
+            auto symbolTable = std::make_shared<SymbolTable>(errorHandler);
+            auto lexer = std::make_shared<LexicalAnalyzer>(symbolTable, errorHandler);
+            lexer->tokenizeSource(source);
+            tokens = lexer->getTokens().size();
+            
+            double seconds;
+            if (engine == 0) {
+                Parser parser(lexer, symbolTable, errorHandler, grammar);
+                parser.generateParseTable();
+                parser.setTraceLevel(TraceLevel::NONE);
+                auto start = std::chrono::steady_clock::now();
+                accepted[engine] = parser.parse();
+                seconds = secondsSince(start);
+            } else {
+                RecursiveDescentParser parser(lexer, symbolTable, errorHandler);
+                auto start = std::chrono::steady_clock::now();
+                accepted[engine] = parser.parse();
+                seconds = secondsSince(start);
+            }
+            if (run == 0 || seconds < best[engine]) best[engine] = seconds;
+        }
+    }
+    
+    scratch.restore();
+    
+    std::cout << "LL(1) table vs recursive descent (" << tokens << " tokens)" << std::endl;
+    const char* names[2] = {"table-driven:     ", "recursive descent:"};
+    for (int engine = 0; engine < 2; ++engine) {
+        std::cout << "  " << names[engine] << " " << (best[engine] * 1e3) << " ms, "
+                  << (best[engine] * 1e9 / tokens) << " ns/token"
+                  << (accepted[engine] ? "" : ", REJECTED") << std::endl;
+    }
+    std::cout << "  speedup:          " << (best[0] / best[1]) << "x" << std::endl;
+}
+
+// FIRST and FOLLOW computation on a generated grammar with one precedence
+// level per operator, the shape of an expression grammar but deeper:
+//   program → e0 ';'
+//   ei → e(i+1) ri          ri → 'opi' e(i+1) ri | ε
+//   en → ID | '(' e0 ')'
+// FIRST(e0) is only known once it has travelled up from en.
+static void benchGrammarAnalysis(size_t levels) {
+    auto grammar = std::make_shared<Grammar>();
+    auto level = [](const char* prefix, size_t i) { return prefix + std::to_string(i); };
+    grammar->addNonTerminal("program");
+    for (size_t i = 0; i <= levels; ++i) {
+        grammar->addNonTerminal(level("e", i));
+        if (i < levels) grammar->addNonTerminal(level("r", i));
+    }
+    for (const char* terminal : {";", "ID", "(", ")"}) {
+        grammar->addTerminal(terminal);
+    }
+    for (size_t i = 0; i < levels; ++i) {
+        grammar->addTerminal(level("op", i));
+    }
+    grammar->setStartSymbol("program");
+    grammar->addProduction("program", {"e0", ";"});
+    for (size_t i = 0; i < levels; ++i) {
+        grammar->addProduction(level("e", i), {level("e", i + 1), level("r", i)});
+        grammar->addProduction(level("r", i), {level("op", i), level("e", i + 1), level("r", i)});
+        grammar->addProduction(level("r", i), {"ε"});
+    }
+    grammar->addProduction(level("e", levels), {"ID"});
+    grammar->addProduction(level("e", levels), {"(", "e0", ")"});
+    
+    // Best of 3
+    double best = 0;
+    for (int run = 0; run < 3; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        grammar->computeFirstSets();
+        grammar->computeFollowSets();
+        double seconds = secondsSince(start);
+        if (run == 0 || seconds < best) best = seconds;
+    }
+    
+    std::cout << "FIRST/FOLLOW (" << grammar->getNonTerminals().size() << " non-terminals, "
+              << grammar->getTerminals().size() << " terminals, " << grammar->getProductions().size()
+              << " productions)" << std::endl;
+    std::cout << "  " << (best * 1e3) << " ms, |FOLLOW(e" << levels << ")| = "
+              << grammar->getFollowSet(grammar->findSymbol(level("e", levels))).size() << std::endl;
+}
+
+// LL(1) Parser::parse, untraced, against the LALR(1) shift/reduce parser
+// built from the same grammar, on the same token streams
+static void benchLalr(const std::string& text) {
+    ScratchDirectory scratch;
+    
+    auto source = std::make_shared<SourceBuffer>(text);
+    auto grammar = std::make_shared<Grammar>();
+    grammar->initializeGrammar();
+    
+    // The tables are built once, as the LL(1) table is by generateParseTable
+    auto buildStart = std::chrono::steady_clock::now();
+    LalrParser tables(nullptr, nullptr, nullptr, grammar);
+    tables.generateTables();
+    double buildSeconds = secondsSince(buildStart);
+    
+    // Best of 3 for each engine, each run on a freshly lexed stream
+    double best[2] = {0, 0};
+    bool accepted[2] = {false, false};
+    size_t tokens = 0;
+    for (int run = 0; run < 3; ++run) {
+        for (int engine = 0; engine < 2; ++engine) {
+            auto errorHandler = std::make_shared<ErrorHandler>(false);
+            auto symbolTable = std::make_shared<SymbolTable>(errorHandler);
+            auto lexer = std::make_shared<LexicalAnalyzer>(symbolTable, errorHandler);
+            lexer->tokenizeSource(source);
+            tokens = lexer->getTokens().size();
+            
+            double seconds;
+            if (engine == 0) {
+                Parser parser(lexer, symbolTable, errorHandler, grammar);
+                parser.generateParseTable();
+                parser.setTraceLevel(TraceLevel::NONE);
+                auto start = std::chrono::steady_clock::now();
+                accepted[engine] = parser.parse();
+                seconds = secondsSince(start);
+            } else {
+                LalrParser parser(lexer, symbolTable, errorHandler, grammar);
+                parser.generateTables();
+                auto start = std::chrono::steady_clock::now();
+                accepted[engine] = parser.parse();
+                seconds = secondsSince(start);
+            }
+            if (run == 0 || seconds < best[engine]) best[engine] = seconds;
+        }
+    }
+    
+    scratch.restore();
+    
+    std::cout << "LL(1) vs LALR(1) on expressions (" << tokens << " tokens, " << tables.getStateCount()
+              << " states, " << tables.getConflictCount() << " conflicts, tables built in "
+              << (buildSeconds * 1e3) << " ms)" << std::endl;
+    const char* names[2] = {"LL(1):  ", "LALR(1):"};
+    for (int engine = 0; engine < 2; ++engine) {
+        std::cout << "  " << names[engine] << " " << (best[engine] * 1e3) << " ms, "
+                  << (best[engine] * 1e9 / tokens) << " ns/token"
+                  << (accepted[engine] ? "" : ", REJECTED") << std::endl;
+    }
+    std::cout << "  speedup:  " << (best[0] / best[1]) << "x" << std::endl;
+}
+
+// Sequential vs parallel Parser::parse of the same token stream, untraced
+static void benchParallelParser(const std::string& text) {
+    ScratchDirectory scratch;
+    
+    auto source = std::make_shared<SourceBuffer>(text);
+    auto grammar = std::make_shared<Grammar>();
+    grammar->initializeGrammar();
+    unsigned cores = std::max(2u, std::thread::hardware_concurrency());
+    
+    std::vector<std::pair<unsigned, double>> results;
+    size_t tokens = 0;
+    bool accepted = true;
+    for (unsigned threads = 1; threads <= cores; threads *= 2) {
+        double best = 0;
+        for (int run = 0; run < 5; ++run) {
+            auto errorHandler = std::make_shared<ErrorHandler>(false);
+            auto symbolTable = std::make_shared<SymbolTable>(errorHandler);
+            auto lexer = std::make_shared<LexicalAnalyzer>(symbolTable, errorHandler);
+            lexer->tokenizeSource(source);
+            tokens = lexer->getTokens().size();
+            
+            Parser parser(lexer, symbolTable, errorHandler, grammar);
+            parser.generateParseTable();
+            parser.setTraceLevel(TraceLevel::NONE);
+            parser.setThreadCount(threads, 0);
+            
+            auto start = std::chrono::steady_clock::now();
+            accepted = parser.parse() && accepted;
+            double seconds = secondsSince(start);
+            if (run == 0 || seconds < best) best = seconds;
+        }
+        results.emplace_back(threads, best);
+    }
+    
+    scratch.restore();
+    
+    std::cout << "Parallel parser (" << tokens << " tokens" << (accepted ? "" : ", REJECTED") << ")" << std::endl;
+    for (const auto& result : results) {
+        std::cout << "  " << result.first << " thread(s): " << (result.second * 1e3) << " ms, speedup "
+                  << (results[0].second / result.second) << "x" << std::endl;
+    }
+}
+
+// Editing a large file: applyEdit plus Parser::reparse, against a full
+// parse of the edited input. Each edit types a character into a statement
+// and the next one deletes it again.
+static void benchReparse(const std::string& text) {
+    ScratchDirectory scratch;
+    
+    auto grammar = std::make_shared<Grammar>();
+    grammar->initializeGrammar();
+    auto errorHandler = std::make_shared<ErrorHandler>(false);
+    auto symbolTable = std::make_shared<SymbolTable>(errorHandler);
+    auto lexer = std::make_shared<LexicalAnalyzer>(symbolTable, errorHandler);
+    lexer->tokenizeSource(std::make_shared<SourceBuffer>(text));
+    
+    Parser parser(lexer, symbolTable, errorHandler, grammar);
+    parser.generateParseTable();
+    parser.setTraceLevel(TraceLevel::NONE);
+    parser.setIncremental(true);
+    auto start = std::chrono::steady_clock::now();
+    parser.parse();
+    double full = secondsSince(start);
+    
+    // In the middle of the file: an assignment, and the body of a while
+    size_t lines = std::count(text.begin(), text.end(), '\n');
+    size_t statement = text.find("accumulated_total_value = accumulated_total_value", text.size() / 2) + 5;
+    size_t body = text.find("{ loop_counter_variable++; }", text.size() / 2) + 5;
+    
+    const int edits = 100;
+    double reparseTime[2] = {0, 0};
+    double editTime[2] = {0, 0};
+    size_t tokens[2] = {0, 0};
+    bool accepted = true;
+    for (int target = 0; target < 2; ++target) {
+        size_t offset = target == 0 ? statement : body;
+        for (int i = 0; i < 2 * edits; ++i) {
+            start = std::chrono::steady_clock::now();
+            if (i % 2 == 0) {
+                lexer->applyEdit(offset, 0, "x");
+            } else {
+                lexer->applyEdit(offset, 1, "");
+            }
+            auto parsed = std::chrono::steady_clock::now();
+            accepted = parser.reparse() && accepted;
+            reparseTime[target] += secondsSince(parsed);
+            editTime[target] += secondsSince(start);
+            tokens[target] = std::max(tokens[target], parser.getLastReparse().tokens);
+        }
+    }
+    
+    scratch.restore();
+    
+    std::cout << "Incremental reparse (" << lines << " lines, " << lexer->getTokens().size() << " tokens"
+              << (accepted ? "" : ", REJECTED") << ")" << std::endl;
+    std::cout << "  full parse:       " << (full * 1e3) << " ms" << std::endl;
+    const char* names[2] = {"statement edit:   ", "while body edit:  "};
+    for (int target = 0; target < 2; ++target) {
+        std::cout << "  " << names[target] << (reparseTime[target] / (2 * edits) * 1e3) << " ms reparse, "
+                  << (editTime[target] / (2 * edits) * 1e3) << " ms with applyEdit (" << tokens[target]
+                  << " tokens reparsed)" << std::endl;
+    }
+}
+
+// Random small programs: declarations, assignments, increments and
+// nested while loops over a few names, with parenthesized operands
+static std::string generateRandomProgram(std::mt19937& random) {
+    static const char* const names[] = {"a", "b", "c", "dd"};
+    auto pick = [&random](size_t count) { return static_cast<size_t>(random() % count); };
+    std::function<std::string(int)> operand = [&](int depth) -> std::string {
+        switch (pick(depth > 1 ? 2 : 4)) {
+            case 0: return names[pick(4)];
+            case 1: return std::to_string(pick(50));
+            case 2: return "(" + operand(depth + 1) + ")";
+            default: return operand(depth + 1) + (pick(2) ? " * " : " - ") + operand(depth + 1);
+        }
+    };
+    std::function<void(std::string&, int)> statements = [&](std::string& text, int depth) {
+        for (size_t i = pick(4); i-- > 0;) {
+            switch (pick(depth < 3 ? 5 : 4)) {
+                case 0: text += "int " + std::string(names[pick(4)]) + (pick(2) ? ", c" : "") + ";\n"; break;
+                case 1: text += std::string(names[pick(4)]) + " = " + operand(0) + ";\n"; break;
+                case 2: text += "++" + std::string(names[pick(4)]) + ";\n"; break;
+                case 3: text += std::string(names[pick(4)]) + "--;\n"; break;
+                default:
+                    text += "while (" + operand(0) + (pick(2) ? " < " : " > ") + operand(0) + ") {\n";
+                    statements(text, depth + 1);
+                    text += "}\n";
+                    break;
+            }
+        }
+    };
+    std::string text = "int main() {\n";
+    statements(text, 0);
+    return text + "}\n";
+}
+
+// What a parse left behind, to compare a reparse with a full parse: the
+// result, the syntax and semantic errors, the symbol table and the tree
+static std::string parseOutcome(bool accepted, const ErrorHandler& errors, const SymbolTable& symbols,
+                                const Parser& parser, const LexicalAnalyzer& lexer) {
+    std::ostringstream out;
+    out << (accepted ? "accepted" : "rejected") << "\n";
+    for (const auto& error : errors.getErrors()) {
+        if (error.type == ErrorType::SYNTAX_ERROR || error.type == ErrorType::SEMANTIC_ERROR) {
+            out << error.line << ":" << error.column << " " << error.message << "\n";
+        }
+    }
+    for (const auto& symbol : symbols.getAllSymbols()) {
+        out << symbol->name << "@" << symbol->offset << " ";
+    }
+    out << "\n";
+    parser.getAst().print(out, *lexer.getInterner(), *lexer.getConstantPool());
+    return out.str();
+}
+
+// Random edits of random programs, each reparsed and checked against a
+// full parse of the edited text. Returns the number that differ.
+static size_t checkReparse(unsigned seed, size_t programs, size_t editsPerProgram) {
+    ScratchDirectory scratch;
+    static const char* const snippets[] = {"", "", "int ", "a = 1;", "while (a < b) {", "}", "{", "(", ")",
+                                           ";", "++b;", "dd", " ", "c--;\n", "(4)", " * "};
+    std::mt19937 random(seed);
+    auto grammar = std::make_shared<Grammar>();
+    grammar->initializeGrammar();
+    
+    // Edits that leave invalid tokens make the lexer say so on stderr
+    std::streambuf* stderrBuffer = std::cerr.rdbuf(nullptr);
+    auto errorHandler = std::make_shared<ErrorHandler>(false);
+    auto fullErrors = std::make_shared<ErrorHandler>(false);
+    
+    size_t checked = 0;
+    size_t differ = 0;
+    std::string firstDifference;
+    for (size_t program = 0; program < programs; ++program) {
+        std::string text = generateRandomProgram(random);
+        errorHandler->clear();
+        auto symbolTable = std::make_shared<SymbolTable>(errorHandler);
+        auto lexer = std::make_shared<LexicalAnalyzer>(symbolTable, errorHandler);
+        lexer->tokenizeSource(std::make_shared<SourceBuffer>(text));
+        Parser parser(lexer, symbolTable, errorHandler, grammar);
+        parser.generateParseTable();
+        parser.setTraceLevel(TraceLevel::NONE);
+        parser.setIncremental(true);
+        parser.parse();
+        
+        for (size_t edit = 0; edit < editsPerProgram; ++edit) {
+            size_t offset = random() % (text.size() + 1);
+            size_t removed = std::min<size_t>(random() % 4, text.size() - offset);
+            std::string inserted = snippets[random() % (sizeof(snippets) / sizeof(snippets[0]))];
+            lexer->applyEdit(offset, removed, inserted);
+            text.replace(offset, removed, inserted);
+            bool accepted = parser.reparse();
+            std::string outcome = parseOutcome(accepted, *errorHandler, *symbolTable, parser, *lexer);
+            
+            fullErrors->clear();
+            auto fullSymbols = std::make_shared<SymbolTable>(fullErrors);
+            auto fullLexer = std::make_shared<LexicalAnalyzer>(fullSymbols, fullErrors);
+            fullLexer->tokenizeSource(std::make_shared<SourceBuffer>(text));
+            Parser full(fullLexer, fullSymbols, fullErrors, grammar);
+            full.generateParseTable();
+            full.setTraceLevel(TraceLevel::NONE);
+            bool fullAccepted = full.parse();
+            std::string expected = parseOutcome(fullAccepted, *fullErrors, *fullSymbols, full, *fullLexer);
+            
+            checked++;
+            if (outcome != expected) {
+                if (differ++ == 0) {
+                    firstDifference = "after applyEdit(" + std::to_string(offset) + ", " + std::to_string(removed) +
+                                      ", \"" + inserted + "\") of:\n" + text + "reparse:\n" + outcome +
+                                      "full parse:\n" + expected;
+                }
+            }
+        }
+    }
+    
+    std::cerr.rdbuf(stderrBuffer);
+    scratch.restore();
+    
+    std::cout << "Reparse check (seed " << seed << "): " << checked << " random edits, " << differ
+              << " differ from a full parse" << std::endl;
+    if (differ > 0) {
+        std::cout << "  first difference, " << firstDifference;
+    }
+    return differ;
+}
+
+int main(int argc, char* argv[]) {
+    size_t statements = 200000;
+    if (argc > 1) {
+        statements = std::strtoul(argv[1], nullptr, 10);
+    }
+    
+    std::string text = generateSource(statements);
+    benchLexer(text);
+    benchParallelLexer(text);
+    benchEdit(text);
+    
+    // The parser is much slower than the lexer; a smaller input is enough
+    benchParser(generateSource(statements / 20));
+    if (std::filesystem::exists("grammar.txt")) {
+        benchParser(generateSource(statements / 20), "grammar.txt");
+    }
+    benchRecursiveDescent(generateSource(statements / 20));
+    benchLalr(generateExpressionSource(statements / 40));
+    benchGrammarAnalysis(200);
+    benchParallelParser(generateSource(statements / 4));
+    benchReparse(generateSource(statements / 4));
+    
+    // The reparse must leave what a full parse leaves
+    return checkReparse(1, 200, 20) == 0 ? 0 : 1;
+}
@@ -0,0 +1,317 @@
+#ifndef BUILTIN_GRAMMAR_H
+#define BUILTIN_GRAMMAR_H
+
+#include <cstddef>
+#include <cstdint>
+
+// The language's grammar as constexpr data, with FIRST, FOLLOW and the LL(1)
+// parse table computed by constexpr functions. Grammar::initializeGrammar
+// loads the symbols, productions and sets from here and the parser copies
+// the table, so no grammar analysis runs when the compiler starts. A
+// conflict in the table fails the build (see the static_assert below).
+//
+// Symbols are numbered as the parser numbers them: non-terminal i is i,
+// terminal j is terminalBit | j. Terminal and non-terminal order matches
+// Grammar::getTerminals() and Grammar::getNonTerminals().
+//
+// Right sides may also contain semantic actions (actionBit | action). They
+// derive ε, so the analysis skips them, and Grammar leaves them out; the
+// parser runs each one when it reaches the top of the stack, to build the
+// AST (see Parser::runAction).
+namespace BuiltinGrammar {
+    constexpr uint16_t terminalBit = 0x8000;
+    constexpr uint16_t actionBit = 0x4000;
+    
+    // Terminals (ε and $ come first, as the Grammar constructor adds them)
+    enum Terminal : uint16_t {
+        EPSILON, END_MARKER,
+        SEMICOLON, COMMA, LEFT_PAREN, RIGHT_PAREN, LEFT_BRACE, RIGHT_BRACE,
+        INT, FLOAT, MAIN, ASSIGN, WHILE, LESS_THAN, GREATER_THAN,
+        INCREMENT, DECREMENT, PLUS, MINUS, MULTIPLY, DIVIDE,
+        ID, CONST,
+        TERMINAL_COUNT
+    };
+    
+    constexpr const char* terminalNames[TERMINAL_COUNT] = {
+        "ε", "$",
+        ";", ",", "(", ")", "{", "}",
+        "int", "float", "main", "=", "while", "<", ">",
+        "++", "--", "+", "-", "*", "/",
+        "ID", "CONST"
+    };
+    
+    // Non-terminals
+    enum NonTerminal : uint16_t {
+        PROGRAM, STMTS, STMT, DECL, TYPE, ID_LIST, ID_TAIL, INIT_OPT,
+        WHILE_STMT, EXPR_STMT, EXPR_STMT_TAIL, EXPR, EXPR_TAIL, TERM, TERM_TAIL,
+        FACTOR, UNARY_OP, COND, REL_OP, ADD_OP, MUL_OP,
+        NON_TERMINAL_COUNT
+    };
+    
+    constexpr const char* nonTerminalNames[NON_TERMINAL_COUNT] = {
+        "program", "stmts", "stmt", "decl", "type", "id_list", "id_tail", "init_opt",
+        "while_stmt", "expr_stmt", "expr_stmt_tail", "expr", "expr_tail", "term", "term_tail",
+        "factor", "unary_op", "cond", "rel_op", "add_op", "mul_op"
+    };
+    
+    constexpr NonTerminal startSymbol = PROGRAM;
+    
+    // Semantic actions. Matching ID or CONST pushes a leaf node onto the
+    // parser's value stack, and matching an operator or a type keyword
+    // pushes its TokenType; actions pop those and push or link nodes.
+    enum Action : uint16_t {
+        BEGIN_LIST,     // Open a statement list
+        END_PROGRAM,    // Close the list into the Program node (root)
+        DECLARE,        // [type id init] -> Decl appended to the list; type is kept
+        END_DECL,       // Drop the declaration's type
+        NO_INIT,        // Push "no initializer"
+        ASSIGN_STMT,    // [id expr] -> Assign appended to the list
+        PREFIX,         // [op id] -> Unary (prefix) appended to the list
+        POSTFIX,        // [id op] -> Unary (postfix) appended to the list
+        WHILE_LOOP,     // [cond], closing the body list -> While appended to the list
+        CONDITION,      // [expr op expr] -> Cond
+        BINARY,         // [expr op expr] -> BinaryExpr; expr_tail/term_tail run it
+                        // before recursing, so chains fold to the left
+        PARENS,         // [expr] after ')': its span takes in the parentheses
+        ACTION_COUNT
+    };
+    
+    // Terminal symbol id
+    constexpr uint16_t t(Terminal terminal) {
+        return static_cast<uint16_t>(terminalBit | terminal);
+    }
+    
+    // Action symbol id
+    constexpr uint16_t a(Action action) {
+        return static_cast<uint16_t>(actionBit | action);
+    }
+    
+    // Production: lhs → rhs[0] ... rhs[length - 1] (nothing but actions is ε)
+    constexpr size_t maxRhs = 9;
+    struct Production {
+        NonTerminal lhs;
+        uint16_t length;
+        uint16_t rhs[maxRhs];
+    };
+    
+    constexpr Production productions[] = {
+        // Program structure
+        {PROGRAM, 9, {t(INT), t(MAIN), t(LEFT_PAREN), t(RIGHT_PAREN), t(LEFT_BRACE), a(BEGIN_LIST), STMTS,
+                      t(RIGHT_BRACE), a(END_PROGRAM)}},
+        
+        // Statements
+        {STMTS, 2, {STMT, STMTS}},
+        {STMTS, 0, {}},
+        
+        // Statement types
+        {STMT, 1, {DECL}},
+        {STMT, 1, {EXPR_STMT}},
+        {STMT, 1, {WHILE_STMT}},
+        
+        // Declaration
+        {DECL, 7, {TYPE, t(ID), INIT_OPT, a(DECLARE), ID_TAIL, t(SEMICOLON), a(END_DECL)}},
+        
+        // Type
+        {TYPE, 1, {t(INT)}},
+        {TYPE, 1, {t(FLOAT)}},
+        
+        // Identifier list tail (for multiple declarations)
+        {ID_TAIL, 5, {t(COMMA), t(ID), INIT_OPT, a(DECLARE), ID_TAIL}},
+        {ID_TAIL, 0, {}},
+        
+        // Initialization option
+        {INIT_OPT, 2, {t(ASSIGN), EXPR}},
+        {INIT_OPT, 1, {a(NO_INIT)}},
+        
+        // Expression statements
+        {EXPR_STMT, 2, {t(ID), EXPR_STMT_TAIL}},
+        {EXPR_STMT, 4, {UNARY_OP, t(ID), t(SEMICOLON), a(PREFIX)}},
+        
+        // Expression statement tail - to disambiguate the ID cases
+        {EXPR_STMT_TAIL, 4, {t(ASSIGN), EXPR, t(SEMICOLON), a(ASSIGN_STMT)}},
+        {EXPR_STMT_TAIL, 3, {t(INCREMENT), t(SEMICOLON), a(POSTFIX)}},
+        {EXPR_STMT_TAIL, 3, {t(DECREMENT), t(SEMICOLON), a(POSTFIX)}},
+        
+        // While statement
+        {WHILE_STMT, 9, {t(WHILE), t(LEFT_PAREN), COND, t(RIGHT_PAREN), t(LEFT_BRACE), a(BEGIN_LIST), STMTS,
+                         t(RIGHT_BRACE), a(WHILE_LOOP)}},
+        
+        // Condition
+        {COND, 4, {EXPR, REL_OP, EXPR, a(CONDITION)}},
+        
+        // Relational operators
+        {REL_OP, 1, {t(LESS_THAN)}},
+        {REL_OP, 1, {t(GREATER_THAN)}},
+        
+        // Expression
+        {EXPR, 2, {TERM, EXPR_TAIL}},
+        
+        // Expression tail
+        {EXPR_TAIL, 4, {ADD_OP, TERM, a(BINARY), EXPR_TAIL}},
+        {EXPR_TAIL, 0, {}},
+        
+        // Term
+        {TERM, 2, {FACTOR, TERM_TAIL}},
+        
+        // Term tail
+        {TERM_TAIL, 4, {MUL_OP, FACTOR, a(BINARY), TERM_TAIL}},
+        {TERM_TAIL, 0, {}},
+        
+        // Factor
+        {FACTOR, 1, {t(ID)}},
+        {FACTOR, 1, {t(CONST)}},
+        {FACTOR, 4, {t(LEFT_PAREN), EXPR, t(RIGHT_PAREN), a(PARENS)}},
+        
+        // Unary operators
+        {UNARY_OP, 1, {t(INCREMENT)}},
+        {UNARY_OP, 1, {t(DECREMENT)}},
+        
+        // Additive operators
+        {ADD_OP, 1, {t(PLUS)}},
+        {ADD_OP, 1, {t(MINUS)}},
+        
+        // Multiplicative operators
+        {MUL_OP, 1, {t(MULTIPLY)}},
+        {MUL_OP, 1, {t(DIVIDE)}}
+    };
+    
+    constexpr size_t productionCount = sizeof(productions) / sizeof(productions[0]);
+    
+    // Total right-side length, actions included
+    constexpr size_t countRhsSymbols() {
+        size_t count = 0;
+        for (const Production& production : productions) {
+            count += production.length;
+        }
+        return count;
+    }
+    constexpr size_t rhsSymbolCount = countRhsSymbols();
+    
+    // Terminal sets are bitmasks over Terminal; bit EPSILON in a FIRST set
+    // means the symbol or sequence derives ε
+    typedef uint32_t TerminalSet;
+    static_assert(TERMINAL_COUNT <= 32, "TerminalSet is too small for the terminals");
+    
+    constexpr TerminalSet bit(uint16_t terminal) {
+        return TerminalSet(1) << terminal;
+    }
+    
+    // Results of the analysis
+    struct Tables {
+        TerminalSet first[NON_TERMINAL_COUNT] = {};
+        TerminalSet follow[NON_TERMINAL_COUNT] = {};
+        
+        // Production index of [non-terminal][terminal], or -1
+        int16_t parseTable[NON_TERMINAL_COUNT][TERMINAL_COUNT] = {};
+        
+        // Right sides reversed for pushing (ε left out, actions kept):
+        // production p is pushSymbols[pushStart[p]] up to pushSymbols[pushStart[p + 1]]
+        uint16_t pushSymbols[rhsSymbolCount] = {};
+        uint32_t pushStart[productionCount + 1] = {};
+        
+        // First cell that two productions were entered into, if any
+        bool hasConflict = false;
+        uint16_t conflictNonTerminal = 0;
+        uint16_t conflictTerminal = 0;
+    };
+    
+    // FIRST of rhs[from..length) given the FIRST sets found so far
+    constexpr TerminalSet firstOfSequence(const Tables& tables, const Production& production, size_t from) {
+        TerminalSet result = 0;
+        for (size_t i = from; i < production.length; ++i) {
+            uint16_t symbol = production.rhs[i];
+            if (symbol & actionBit) continue;
+            TerminalSet first = (symbol & terminalBit) ? bit(symbol & ~terminalBit) : tables.first[symbol];
+            result |= first & ~bit(EPSILON);
+            if (!(first & bit(EPSILON))) {
+                return result;
+            }
+        }
+        return result | bit(EPSILON);
+    }
+    
+    // Fixed-point FIRST and FOLLOW computation, then the LL(1) table and
+    // the push sequences
+    constexpr Tables analyze() {
+        Tables tables;
+        
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (const Production& production : productions) {
+                TerminalSet first = tables.first[production.lhs] | firstOfSequence(tables, production, 0);
+                if (first != tables.first[production.lhs]) {
+                    tables.first[production.lhs] = first;
+                    changed = true;
+                }
+            }
+        }
+        
+        tables.follow[startSymbol] = bit(END_MARKER);
+        changed = true;
+        while (changed) {
+            changed = false;
+            for (const Production& production : productions) {
+                for (size_t i = 0; i < production.length; ++i) {
+                    uint16_t symbol = production.rhs[i];
+                    if (symbol & (terminalBit | actionBit)) continue;
+                    
+                    // FIRST of what follows, and FOLLOW(lhs) if that can vanish
+                    TerminalSet rest = firstOfSequence(tables, production, i + 1);
+                    TerminalSet follow = tables.follow[symbol] | (rest & ~bit(EPSILON));
+                    if (rest & bit(EPSILON)) {
+                        follow |= tables.follow[production.lhs];
+                    }
+                    if (follow != tables.follow[symbol]) {
+                        tables.follow[symbol] = follow;
+                        changed = true;
+                    }
+                }
+            }
+        }
+        
+        for (size_t nt = 0; nt < NON_TERMINAL_COUNT; ++nt) {
+            for (size_t terminal = 0; terminal < TERMINAL_COUNT; ++terminal) {
+                tables.parseTable[nt][terminal] = -1;
+            }
+        }
+        
+        for (size_t p = 0; p < productionCount; ++p) {
+            const Production& production = productions[p];
+            TerminalSet predict = firstOfSequence(tables, production, 0);
+            if (predict & bit(EPSILON)) {
+                predict |= tables.follow[production.lhs];
+            }
+            predict &= ~bit(EPSILON);
+            
+            for (uint16_t terminal = 0; terminal < TERMINAL_COUNT; ++terminal) {
+                if (!(predict & bit(terminal))) continue;
+                
+                int16_t& entry = tables.parseTable[production.lhs][terminal];
+                if (entry >= 0 && !tables.hasConflict) {
+                    tables.hasConflict = true;
+                    tables.conflictNonTerminal = production.lhs;
+                    tables.conflictTerminal = terminal;
+                }
+                entry = static_cast<int16_t>(p);
+            }
+        }
+        
+        uint32_t pushed = 0;
+        for (size_t p = 0; p < productionCount; ++p) {
+            tables.pushStart[p] = pushed;
+            for (size_t i = productions[p].length; i-- > 0;) {
+                tables.pushSymbols[pushed++] = productions[p].rhs[i];
+            }
+        }
+        tables.pushStart[productionCount] = pushed;
+        
+        return tables;
+    }
+    
+    inline constexpr Tables tables = analyze();
+    
+    static_assert(!tables.hasConflict, "The built-in grammar is not LL(1): its parse table has a conflict");
+}
+
+#endif // BUILTIN_GRAMMAR_H
@@ -0,0 +1,91 @@
+#include "constant_pool.h"
+#include <cstring>
+
+namespace {
+
+// Initial number of hash slots (a power of two)
+const size_t initialSlots = 64;
+
+} // namespace
+
+// Constructor
+ConstantPool::ConstantPool() : slots(initialSlots, 0) {}
+
+// Multiply-shift hash of the value bits, with the kind folded in
+uint32_t ConstantPool::hash(uint64_t value, bool isFloat) {
+    uint64_t h = (value ^ (isFloat ? 0x5555555555555555ull : 0)) * 0x9E3779B97F4A7C15ull;
+    return static_cast<uint32_t>(h >> 32);
+}
+
+// Double the table and reinsert every index
+void ConstantPool::grow() {
+    slots.assign(slots.size() * 2, 0);
+    size_t mask = slots.size() - 1;
+    for (uint32_t index = 0; index < bits.size(); ++index) {
+        size_t i = hash(bits[index], floats[index]) & mask;
+        while (slots[i] != 0) i = (i + 1) & mask;
+        slots[i] = index + 1;
+    }
+}
+
+// Add a constant, or find the equal one already stored
+uint32_t ConstantPool::add(uint64_t value, bool isFloat) {
+    size_t mask = slots.size() - 1;
+    size_t i = hash(value, isFloat) & mask;
+    for (; slots[i] != 0; i = (i + 1) & mask) {
+        uint32_t index = slots[i] - 1;
+        if (bits[index] == value && floats[index] == isFloat) return index;
+    }
+    
+    uint32_t index = static_cast<uint32_t>(bits.size());
+    bits.push_back(value);
+    floats.push_back(isFloat);
+    slots[i] = index + 1;
+    
+    // Keep the load factor at or below one half
+    if (bits.size() * 2 > slots.size()) {
+        grow();
+    }
+    return index;
+}
+
+// Add an integer constant
+uint32_t ConstantPool::addInteger(int64_t value) {
+    return add(static_cast<uint64_t>(value), false);
+}
+
+// Add a floating-point constant
+uint32_t ConstantPool::addFloat(double value) {
+    uint64_t raw;
+    std::memcpy(&raw, &value, sizeof(raw));
+    return add(raw, true);
+}
+
+// Check the kind of an index
+bool ConstantPool::isFloat(uint32_t index) const {
+    return floats[index];
+}
+
+// Get an integer constant
+int64_t ConstantPool::integerValue(uint32_t index) const {
+    return static_cast<int64_t>(bits[index]);
+}
+
+// Get a floating-point constant
+double ConstantPool::floatValue(uint32_t index) const {
+    double value;
+    std::memcpy(&value, &bits[index], sizeof(value));
+    return value;
+}
+
+// Number of constants
+size_t ConstantPool::size() const {
+    return bits.size();
+}
+
+// Remove every constant
+void ConstantPool::clear() {
+    bits.clear();
+    floats.clear();
+    slots.assign(initialSlots, 0);
+}
@@ -0,0 +1,52 @@
+#ifndef CONSTANT_POOL_H
+#define CONSTANT_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Literal constant pool.
+// The lexer converts each INTEGER_LITERAL and FLOAT_LITERAL once and stores
+// the value here; the token's value is the pool index. Equal constants of
+// the same kind share one index, so the handful of values a program keeps
+// repeating (0, 1, 2, ...) take one entry each. Indices are dense, starting
+// at 0, and stay valid for the life of the pool.
+class ConstantPool {
+private:
+    std::vector<uint64_t> bits;     // Value of each index (int64_t or double bits)
+    std::vector<uint8_t> floats;    // Whether each index holds a double
+    std::vector<uint32_t> slots;    // Open-addressed table of index + 1 (0 = empty)
+    
+    static uint32_t hash(uint64_t value, bool isFloat);
+    
+    // Add a constant, or return the index of an equal one
+    uint32_t add(uint64_t value, bool isFloat);
+    
+    // Double the slot table
+    void grow();
+    
+public:
+    // Token value of a literal that could not be converted (out of range)
+    static constexpr uint32_t npos = UINT32_MAX;
+    
+    // Constructor
+    ConstantPool();
+    
+    // Index of a constant, adding it if it is new. Doubles are compared
+    // bit for bit.
+    uint32_t addInteger(int64_t value);
+    uint32_t addFloat(double value);
+    
+    // Kind and value of an index
+    bool isFloat(uint32_t index) const;
+    int64_t integerValue(uint32_t index) const;
+    double floatValue(uint32_t index) const;
+    
+    // Number of distinct constants
+    size_t size() const;
+    
+    // Forget every constant
+    void clear();
+};
+
+#endif // CONSTANT_POOL_H
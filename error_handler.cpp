@@ -1,4 +1,5 @@
 #include "error_handler.h"
+#include "source_location.h"
 
 // Constructor
 ErrorHandler::ErrorHandler(bool consoleOutput) 
@@ -18,22 +19,38 @@ ErrorHandler::ErrorHandler(bool consoleOutput)
     clearFile.close();
 }
 
-// Report an error
-void ErrorHandler::reportError(ErrorType type, const std::string& message, int line, int column) {
-    Error error(type, message, line, column);
-    errors.push_back(error);
-    
-    // Create error message
+// Set the line index
+void ErrorHandler::setLineIndex(std::shared_ptr<const LineIndex> index) {
+    lineIndex = index;
+}
+
+// Report an error at a source offset
+void ErrorHandler::reportError(ErrorType type, const std::string& message, size_t offset) {
+    SourceLocation location = lineIndex ? lineIndex->resolve(offset) : SourceLocation();
+    reportError(type, message, location.line, location.column);
+}
+
+// Line of the error log for an error
+static std::string logLine(const Error& error) {
     std::string typeStr;
-    switch (type) {
+    switch (error.type) {
         case ErrorType::LEXICAL_ERROR: typeStr = "Lexical Error"; break;
         case ErrorType::SYNTAX_ERROR: typeStr = "Syntax Error"; break;
         case ErrorType::SEMANTIC_ERROR: typeStr = "Semantic Error"; break;
         case ErrorType::WARNING: typeStr = "Warning"; break;
     }
     
-    std::string errorMsg = typeStr + " at line " + std::to_string(line) + 
-                          ", column " + std::to_string(column) + ": " + message;
+    return typeStr + " at line " + std::to_string(error.line) + 
+           ", column " + std::to_string(error.column) + ": " + error.message;
+}
+
+// Report an error
+void ErrorHandler::reportError(ErrorType type, const std::string& message, int line, int column) {
+    Error error(type, message, line, column);
+    errors.push_back(error);
+    
+    // Create error message
+    std::string errorMsg = logLine(error);
     
     // Add to error log
     errorLog += errorMsg + "\n";
@@ -57,16 +74,31 @@ void ErrorHandler::lexicalError(const std::string& message, int line, int column
     reportError(ErrorType::LEXICAL_ERROR, message, line, column);
 }
 
+// Report a lexical error at an offset
+void ErrorHandler::lexicalError(const std::string& message, size_t offset) {
+    reportError(ErrorType::LEXICAL_ERROR, message, offset);
+}
+
 // Report a syntax error
 void ErrorHandler::syntaxError(const std::string& message, int line, int column) {
     reportError(ErrorType::SYNTAX_ERROR, message, line, column);
 }
 
+// Report a syntax error at an offset
+void ErrorHandler::syntaxError(const std::string& message, size_t offset) {
+    reportError(ErrorType::SYNTAX_ERROR, message, offset);
+}
+
 // Report a semantic error
 void ErrorHandler::semanticError(const std::string& message, int line, int column) {
     reportError(ErrorType::SEMANTIC_ERROR, message, line, column);
 }
 
+// Report a semantic error at an offset
+void ErrorHandler::semanticError(const std::string& message, size_t offset) {
+    reportError(ErrorType::SEMANTIC_ERROR, message, offset);
+}
+
 // Report a warning
 void ErrorHandler::warning(const std::string& message, int line, int column) {
     reportError(ErrorType::WARNING, message, line, column);
@@ -166,6 +198,27 @@ void ErrorHandler::printErrors() const {
     std::cout << "=====================================" << std::endl;
 }
 
+// Clear the errors of one type, and rewrite the log and error.txt with the rest
+void ErrorHandler::clear(ErrorType type) {
+    auto removed = std::remove_if(errors.begin(), errors.end(),
+                                  [type](const Error& error) { return error.type == type; });
+    if (removed == errors.end()) {
+        return;
+    }
+    errors.erase(removed, errors.end());
+    
+    errorLog.clear();
+    hasErrors = false;
+    for (const auto& error : errors) {
+        errorLog += logLine(error) + "\n";
+        if (error.type != ErrorType::WARNING) {
+            hasErrors = true;
+        }
+    }
+    std::ofstream file("output/error.txt", std::ios::trunc);
+    file << errorLog;
+}
+
 // Clear all errors
 void ErrorHandler::clear() {
     errors.clear();
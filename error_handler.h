@@ -8,6 +8,8 @@
 #include <memory>
 #include <algorithm>
 
+class LineIndex;
+
 // Error types
 enum class ErrorType {
     LEXICAL_ERROR,
@@ -35,6 +37,9 @@ private:
     bool hasErrors;
     bool outputToConsole;
     
+    // Resolves source offsets for the offset-based overloads
+    std::shared_ptr<const LineIndex> lineIndex;
+    
     // Helper methods for error reporting
     void writeErrorsByType(std::ofstream& file, ErrorType type, const std::string& typeTitle);
     void writeToErrorFile(const std::string& errorMsg);
@@ -43,17 +48,27 @@ public:
     // Constructor
     ErrorHandler(bool consoleOutput = true);
     
+    // Set the line index used to resolve offsets (the lexer sets its own)
+    void setLineIndex(std::shared_ptr<const LineIndex> index);
+    
     // Add an error to the error list
     void reportError(ErrorType type, const std::string& message, int line, int column);
     
+    // Add an error at a source offset; line and column are resolved now,
+    // on the error path, rather than tracked for every token
+    void reportError(ErrorType type, const std::string& message, size_t offset);
+    
     // Add a lexical error
     void lexicalError(const std::string& message, int line, int column);
+    void lexicalError(const std::string& message, size_t offset);
     
     // Add a syntax error
     void syntaxError(const std::string& message, int line, int column);
+    void syntaxError(const std::string& message, size_t offset);
     
     // Add a semantic error
     void semanticError(const std::string& message, int line, int column);
+    void semanticError(const std::string& message, size_t offset);
     
     // Add a warning
     void warning(const std::string& message, int line, int column);
@@ -72,6 +87,9 @@ public:
     
     // Clear all errors
     void clear();
+    
+    // Clear the errors of one type (a reparse replaces the parser's)
+    void clear(ErrorType type);
 };
 
 #endif // ERROR_HANDLER_H 
\ No newline at end of file
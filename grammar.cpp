@@ -1,16 +1,23 @@
 #include "grammar.h"
+#include "builtin_grammar.h"
+#include "grammar_cache.h"
+#include "source_buffer.h"
 #include <algorithm>
+#include <cctype>
 #include <stdexcept>
+#include <unordered_map>
 
 Grammar::Grammar() 
-    : epsilon("ε", SymbolType::TERMINAL), 
-      endMarker("$", SymbolType::TERMINAL) {
+    : setWords(0), epsilon("ε", SymbolType::TERMINAL), 
+      endMarker("$", SymbolType::TERMINAL), builtin(false), textHash(0) {
     // Add special symbols
     terminals.push_back(epsilon);
     terminals.push_back(endMarker);
 }
 
 void Grammar::addTerminal(const std::string& name) {
+    discardPrecomputed();
+    
     // Check if terminal already exists
     for (const auto& term : terminals) {
         if (term.name == name) return;
@@ -19,6 +26,8 @@ void Grammar::addTerminal(const std::string& name) {
 }
 
 void Grammar::addNonTerminal(const std::string& name) {
+    discardPrecomputed();
+    
     // Check if non-terminal already exists
     for (const auto& nonTerm : nonTerminals) {
         if (nonTerm.name == name) return;
@@ -27,6 +36,8 @@ void Grammar::addNonTerminal(const std::string& name) {
 }
 
 void Grammar::addProduction(const std::string& lhs, const std::vector<std::string>& rhs) {
+    discardPrecomputed();
+    
     // Find or create left-hand side non-terminal
     GrammarSymbol leftSymbol = findSymbol(lhs);
     if (leftSymbol.type != SymbolType::NON_TERMINAL) {
@@ -114,307 +125,502 @@ void Grammar::printGrammar() const {
 }
 
 void Grammar::initializeGrammar() {
-    // Add terminals
-    addTerminal(";");
-    addTerminal(",");
-    addTerminal("(");
-    addTerminal(")");
-    addTerminal("{");
-    addTerminal("}");
-    addTerminal("int");
-    addTerminal("float");
-    addTerminal("main");
-    addTerminal("=");
-    addTerminal("while");
-    addTerminal("<");
-    addTerminal(">");
-    addTerminal("++");
-    addTerminal("--");
-    addTerminal("+");
-    addTerminal("-");
-    addTerminal("*");
-    addTerminal("/");
-    addTerminal("ID");
-    addTerminal("CONST");
+    using namespace BuiltinGrammar;
+    
+    // Add terminals (ε and $ are already there)
+    for (const char* name : terminalNames) {
+        addTerminal(name);
+    }
     
     // Add non-terminals
-    addNonTerminal("program");
-    addNonTerminal("stmts");
-    addNonTerminal("stmt");
-    addNonTerminal("decl");
-    addNonTerminal("type");
-    addNonTerminal("id_list");
-    addNonTerminal("id_tail");
-    addNonTerminal("init_opt");
-    addNonTerminal("while_stmt");
-    addNonTerminal("expr_stmt");
-    addNonTerminal("expr_stmt_tail");
-    addNonTerminal("expr");
-    addNonTerminal("expr_tail");
-    addNonTerminal("term");
-    addNonTerminal("term_tail");
-    addNonTerminal("factor");
-    addNonTerminal("unary_op");
-    addNonTerminal("cond");
-    addNonTerminal("rel_op");
-    addNonTerminal("add_op");
-    addNonTerminal("mul_op");
+    for (const char* name : nonTerminalNames) {
+        addNonTerminal(name);
+    }
     
     // Set the start symbol
-    setStartSymbol("program");
+    setStartSymbol(nonTerminalNames[BuiltinGrammar::startSymbol]);
     
     // Add productions
-    // Program structure
-    addProduction("program", {"int", "main", "(", ")", "{", "stmts", "}"});
-    
-    // Statements
-    addProduction("stmts", {"stmt", "stmts"});
-    addProduction("stmts", {"ε"});
-    
-    // Statement types
-    addProduction("stmt", {"decl"});
-    addProduction("stmt", {"expr_stmt"});
-    addProduction("stmt", {"while_stmt"});
-    
-    // Declaration
-    addProduction("decl", {"type", "ID", "init_opt", "id_tail", ";"});
-    
-    // Type
-    addProduction("type", {"int"});
-    addProduction("type", {"float"});
-    
-    // Identifier list tail (for multiple declarations)
-    addProduction("id_tail", {",", "ID", "init_opt", "id_tail"});
-    addProduction("id_tail", {"ε"});
-    
-    // Initialization option
-    addProduction("init_opt", {"=", "expr"});
-    addProduction("init_opt", {"ε"});
-    
-    // Expression statements
-    addProduction("expr_stmt", {"ID", "expr_stmt_tail"});
-    addProduction("expr_stmt", {"unary_op", "ID", ";"});
+    for (const auto& production : BuiltinGrammar::productions) {
+        std::vector<std::string> rhs;
+        for (size_t i = 0; i < production.length; ++i) {
+            uint16_t symbol = production.rhs[i];
+            if (symbol & actionBit) continue;  // Semantic actions are the parser's business
+            rhs.push_back((symbol & terminalBit) ? terminalNames[symbol & ~terminalBit] : nonTerminalNames[symbol]);
+        }
+        if (rhs.empty()) {
+            rhs.push_back("ε");
+        }
+        addProduction(nonTerminalNames[production.lhs], rhs);
+    }
     
-    // Expression statement tail - to disambiguate the ID cases
-    addProduction("expr_stmt_tail", {"=", "expr", ";"});
-    addProduction("expr_stmt_tail", {"++", ";"});
-    addProduction("expr_stmt_tail", {"--", ";"});
+    // FIRST and FOLLOW sets were computed at compile time
+    loadBuiltinSets();
+    builtin = true;
     
-    // While statement
-    addProduction("while_stmt", {"while", "(", "cond", ")", "{", "stmts", "}"});
+    // Print the FIRST set of program for debugging (compiled out with the
+    // parser's DEBUG lines)
+#ifndef PARSER_NO_DEBUG
+    std::cout << "DEBUG: FIRST(program) = { ";
+    for (const auto& symbol : getFirstSet(findSymbol("program"))) {
+        std::cout << symbol.name << " ";
+    }
+    std::cout << "}" << std::endl;
+#endif
+}
+
+// Copy the compile-time terminal bitmasks (one word each)
+void Grammar::loadBuiltinSets() {
+    using namespace BuiltinGrammar;
     
-    // Condition
-    addProduction("cond", {"expr", "rel_op", "expr"});
+    setWords = 1;
+    firstBits.assign(std::begin(tables.first), std::end(tables.first));
+    followBits.assign(std::begin(tables.follow), std::end(tables.follow));
     
-    // Relational operators
-    addProduction("rel_op", {"<"});
-    addProduction("rel_op", {">"});
+    firstSets.clear();
+    followSets.clear();
+}
+
+// Forget the built-in or cached sets and table
+void Grammar::discardPrecomputed() {
+    builtin = false;
+    cache.reset();
+    cachePath.clear();
+}
+
+namespace {
+
+// Whether an unquoted name is a token class the lexer produces (ID, CONST):
+// such names are terminals, and rules for them describe the lexer
+bool isTokenClass(const std::string& name) {
+    if (name.empty() || !std::isupper(static_cast<unsigned char>(name[0]))) return false;
+    for (char c : name) {
+        if (std::islower(static_cast<unsigned char>(c))) return false;
+    }
+    return true;
+}
+
+bool isNameChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+// Terminals of a quoted string, one per token: 'int main() {' is
+// int, main, (, ) and {
+void splitQuoted(std::string_view text, std::vector<std::string>& out) {
+    size_t i = 0;
+    while (i < text.size()) {
+        char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (isNameChar(c)) {
+            size_t start = i;
+            while (i < text.size() && isNameChar(text[i])) ++i;
+            out.emplace_back(text.substr(start, i - start));
+        } else if ((c == '+' || c == '-') && i + 1 < text.size() && text[i + 1] == c) {
+            out.emplace_back(text.substr(i, 2));
+            i += 2;
+        } else {
+            out.emplace_back(1, c);
+            ++i;
+        }
+    }
+}
+
+} // namespace
+
+// Add the symbols and productions of grammar text
+void Grammar::parseGrammarText(std::string_view text, const std::string& file) {
+    const std::string arrow = "→";
+    const std::string epsilonText = "ε";
+    
+    // Rules in file order: "lhs → alternatives", continued on lines that
+    // start with '|'
+    struct Rule {
+        std::string lhs;
+        std::string rhs;
+        size_t line;
+        std::vector<std::vector<std::string>> alternatives;
+    };
+    std::vector<Rule> rules;
+    auto fail = [&](size_t line, const std::string& message) {
+        throw std::runtime_error(file + ":" + std::to_string(line) + ": " + message);
+    };
+    
+    size_t lineNumber = 0;
+    size_t position = 0;
+    while (position < text.size()) {
+        size_t end = text.find('\n', position);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(position, end - position);
+        position = end + 1;
+        ++lineNumber;
+        
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos || line.compare(first, 2, "//") == 0) continue;
+        line = line.substr(first);
+        
+        if (line[0] == '|') {
+            if (rules.empty()) fail(lineNumber, "'|' before any rule");
+            rules.back().rhs += " ";
+            rules.back().rhs += line;
+            continue;
+        }
+        
+        size_t split = line.find(arrow);
+        if (split == std::string_view::npos) fail(lineNumber, "expected 'lhs → ...'");
+        std::string lhs(line.substr(0, split));
+        lhs.erase(lhs.find_last_not_of(" \t") + 1);
+        if (lhs.empty() || !std::all_of(lhs.begin(), lhs.end(), isNameChar)) {
+            fail(lineNumber, "bad left side '" + lhs + "'");
+        }
+        rules.push_back({lhs, std::string(line.substr(split + arrow.size())), lineNumber, {}});
+    }
     
-    // Expression
-    addProduction("expr", {"term", "expr_tail"});
+    // Rules for token classes are the lexer's business
+    rules.erase(std::remove_if(rules.begin(), rules.end(),
+                               [](const Rule& rule) { return isTokenClass(rule.lhs); }),
+                rules.end());
+    if (rules.empty()) fail(lineNumber, "no grammar rules");
     
-    // Expression tail
-    addProduction("expr_tail", {"add_op", "term", "expr_tail"});
-    addProduction("expr_tail", {"ε"});
+    std::map<std::string, std::vector<size_t>> rulesFor;
+    for (size_t r = 0; r < rules.size(); ++r) {
+        rulesFor[rules[r].lhs].push_back(r);
+    }
     
-    // Term
-    addProduction("term", {"factor", "term_tail"});
+    // Split the right sides of the rules reachable from the start symbol
+    // (the first rule's left side); others, like the lexical rules after
+    // the token classes, are left out
+    std::set<std::string> reachable = {rules[0].lhs};
+    std::vector<std::string> pending = {rules[0].lhs};
+    while (!pending.empty()) {
+        std::string name = pending.back();
+        pending.pop_back();
+        for (size_t r : rulesFor[name]) {
+            Rule& rule = rules[r];
+            const std::string& rhs = rule.rhs;
+            rule.alternatives.emplace_back();
+            bool sawEpsilon = false;
+            size_t i = 0;
+            while (true) {
+                while (i < rhs.size() && std::isspace(static_cast<unsigned char>(rhs[i]))) ++i;
+                if (i == rhs.size() || rhs[i] == '|') {
+                    if (rule.alternatives.back().empty() && !sawEpsilon) {
+                        fail(rule.line, "empty alternative (write ε)");
+                    }
+                    if (i == rhs.size()) break;
+                    rule.alternatives.emplace_back();
+                    sawEpsilon = false;
+                    ++i;
+                } else if (rhs[i] == '\'') {
+                    size_t close = rhs.find('\'', i + 1);
+                    if (close == std::string::npos) fail(rule.line, "unterminated quoted terminal");
+                    splitQuoted(std::string_view(rhs).substr(i + 1, close - i - 1), rule.alternatives.back());
+                    i = close + 1;
+                } else if (rhs.compare(i, epsilonText.size(), epsilonText) == 0) {
+                    sawEpsilon = true;
+                    i += epsilonText.size();
+                } else if (isNameChar(rhs[i])) {
+                    size_t start = i;
+                    while (i < rhs.size() && isNameChar(rhs[i])) ++i;
+                    std::string symbol = rhs.substr(start, i - start);
+                    if (rulesFor.count(symbol)) {
+                        if (reachable.insert(symbol).second) pending.push_back(symbol);
+                    } else if (!isTokenClass(symbol)) {
+                        fail(rule.line, "undefined symbol '" + symbol + "'");
+                    }
+                    rule.alternatives.back().push_back(symbol);
+                } else {
+                    fail(rule.line, "unexpected '" + std::string(1, rhs[i]) + "'");
+                }
+            }
+        }
+    }
     
-    // Term tail
-    addProduction("term_tail", {"mul_op", "factor", "term_tail"});
-    addProduction("term_tail", {"ε"});
+    // Non-terminals in the order they are defined, terminals in the order
+    // they are used, productions in file order
+    for (const Rule& rule : rules) {
+        if (reachable.count(rule.lhs)) addNonTerminal(rule.lhs);
+    }
+    for (const Rule& rule : rules) {
+        for (const auto& alternative : rule.alternatives) {
+            for (const auto& symbol : alternative) {
+                if (!rulesFor.count(symbol)) addTerminal(symbol);
+            }
+        }
+    }
+    setStartSymbol(rules[0].lhs);
+    for (const Rule& rule : rules) {
+        for (const auto& alternative : rule.alternatives) {
+            addProduction(rule.lhs, alternative.empty() ? std::vector<std::string>{"ε"} : alternative);
+        }
+    }
+}
+
+// Copy symbols, productions and FIRST and FOLLOW sets from a cache
+void Grammar::loadFromCache(const GrammarCache& compiled) {
+    // ε and $ are already there
+    for (size_t terminal = 2; terminal < compiled.getTerminalCount(); ++terminal) {
+        addTerminal(std::string(compiled.terminalName(terminal)));
+    }
+    for (size_t nt = 0; nt < compiled.getNonTerminalCount(); ++nt) {
+        addNonTerminal(std::string(compiled.nonTerminalName(nt)));
+    }
+    setStartSymbol(nonTerminals[compiled.getStartSymbol()].name);
     
-    // Factor
-    addProduction("factor", {"ID"});
-    addProduction("factor", {"CONST"});
-    addProduction("factor", {"(", "expr", ")"});
+    for (size_t p = 0; p < compiled.getProductionCount(); ++p) {
+        std::vector<GrammarSymbol> rhs;
+        for (const uint16_t* symbol = compiled.rhsBegin(p); symbol != compiled.rhsEnd(p); ++symbol) {
+            rhs.push_back((*symbol & 0x8000) ? terminals[*symbol & 0x7FFF] : nonTerminals[*symbol]);
+        }
+        if (rhs.empty()) {
+            rhs.push_back(epsilon);
+        }
+        productions.emplace_back(nonTerminals[compiled.productionLhs(p)], rhs);
+    }
     
-    // Unary operators
-    addProduction("unary_op", {"++"});
-    addProduction("unary_op", {"--"});
+    setWords = compiled.getSetWords();
+    size_t words = nonTerminals.size() * setWords;
+    firstBits.assign(compiled.firstBits(), compiled.firstBits() + words);
+    followBits.assign(compiled.followBits(), compiled.followBits() + words);
     
-    // Additive operators
-    addProduction("add_op", {"+"});
-    addProduction("add_op", {"-"});
+    firstSets.clear();
+    followSets.clear();
+}
+
+// Load a grammar file, or its cache
+void Grammar::loadFromFile(const std::string& path) {
+    auto text = SourceBuffer::fromFile(path);
+    if (!text) {
+        throw std::runtime_error("Could not open grammar file " + path);
+    }
     
-    // Multiplicative operators
-    addProduction("mul_op", {"*"});
-    addProduction("mul_op", {"/"});
+    *this = Grammar();
+    uint64_t hash = GrammarCache::hash(text->view());
+    std::string cacheFile = path + ".cache";
+    if (auto compiled = GrammarCache::open(cacheFile, hash)) {
+        loadFromCache(*compiled);
+        cache = std::move(compiled);
+        return;
+    }
     
-    // Compute FIRST and FOLLOW sets right away
-    computeFirstSets();
-    computeFollowSets();
+    parseGrammarText(text->view(), path);
+    cachePath = cacheFile;
+    textHash = hash;
+}
+
+// Parse table from the cache
+const int16_t* Grammar::getCompiledTable() const {
+    return cache ? cache->parseTable() : nullptr;
+}
+
+// Write the cache for a grammar loaded from a file
+void Grammar::saveCompiledTable(const std::vector<int16_t>& parseTable) {
+    if (cachePath.empty()) return;
     
-    // Print the FIRST set of program for debugging
-    std::cout << "DEBUG: FIRST(program) = { ";
-    for (const auto& symbol : getFirstSet(findSymbol("program"))) {
-        std::cout << symbol.name << " ";
+    if (!GrammarCache::write(cachePath, textHash, *this, parseTable)) {
+        std::cerr << "Warning: Could not write grammar cache " << cachePath << std::endl;
     }
-    std::cout << "}" << std::endl;
+    cachePath.clear();
 }
 
-// FIRST set computation
-void Grammar::computeFirstSets() {
-    // Initialize FIRST sets
-    for (const auto& terminal : terminals) {
-        firstSets[terminal].insert(terminal);
+namespace {
+
+// Symbol numbering of the set computations: non-terminal i of
+// getNonTerminals() is i, terminal j of getTerminals() is terminalFlag | j
+constexpr uint32_t terminalFlag = 0x80000000u;
+
+// Terminal indices of ε and $ (the Grammar constructor adds them first)
+constexpr size_t epsilonIndex = 0;
+constexpr size_t endMarkerIndex = 1;
+
+// Productions by symbol number, without ε. Production p is
+// symbols[start[p]] up to symbols[start[p + 1]].
+struct NumberedProductions {
+    std::vector<uint32_t> lhs;
+    std::vector<uint32_t> symbols;
+    std::vector<uint32_t> start;
+};
+
+NumberedProductions numberProductions(const Grammar& grammar) {
+    std::unordered_map<std::string, uint32_t> ids;
+    const auto& nonTerminals = grammar.getNonTerminals();
+    const auto& terminals = grammar.getTerminals();
+    for (size_t i = 0; i < nonTerminals.size(); ++i) {
+        ids.emplace(nonTerminals[i].name, static_cast<uint32_t>(i));
+    }
+    for (size_t j = 0; j < terminals.size(); ++j) {
+        ids.emplace(terminals[j].name, static_cast<uint32_t>(terminalFlag | j));
     }
     
-    for (const auto& nonTerminal : nonTerminals) {
-        firstSets[nonTerminal] = {};
+    NumberedProductions numbered;
+    numbered.start.push_back(0);
+    for (const auto& production : grammar.getProductions()) {
+        numbered.lhs.push_back(ids.at(production.leftSide.name));
+        for (const auto& symbol : production.rightSide) {
+            uint32_t id = ids.at(symbol.name);
+            if (id != (terminalFlag | epsilonIndex)) {
+                numbered.symbols.push_back(id);
+            }
+        }
+        numbered.start.push_back(static_cast<uint32_t>(numbered.symbols.size()));
+    }
+    return numbered;
+}
+
+// Propagate sets along edges (edges[a] lists the b with set(a) ⊆ set(b))
+// until nothing changes. Only a set that grew is propagated again, and
+// each propagation ORs one set into another a word at a time.
+void propagate(std::vector<uint64_t>& bits, size_t words, const std::vector<std::vector<uint32_t>>& edges) {
+    std::vector<uint32_t> worklist;
+    std::vector<bool> queued(edges.size(), true);
+    for (size_t i = edges.size(); i-- > 0;) {
+        worklist.push_back(static_cast<uint32_t>(i));
     }
     
-    // Keep computing until no changes
-    bool changed = true;
-    while (changed) {
-        changed = false;
+    while (!worklist.empty()) {
+        uint32_t from = worklist.back();
+        worklist.pop_back();
+        queued[from] = false;
         
-        for (const auto& production : productions) {
-            const GrammarSymbol& X = production.leftSide;
-            const std::vector<GrammarSymbol>& rhs = production.rightSide;
-            
-            size_t size_before = firstSets[X].size();
-            
-            // Empty production
-            if (rhs.empty() || rhs[0].name == "ε") {
-                if (firstSets[X].insert(epsilon).second) {
-                    changed = true;
-                }
-                continue;
+        const uint64_t* source = &bits[from * words];
+        for (uint32_t to : edges[from]) {
+            uint64_t* target = &bits[to * words];
+            uint64_t grew = 0;
+            for (size_t w = 0; w < words; ++w) {
+                grew |= source[w] & ~target[w];
+                target[w] |= source[w];
             }
-            
-            // Add FIRST(Y₁) to FIRST(X) if Y₁ is the first symbol in the production
-            std::set<GrammarSymbol> firstOfY1 = firstSets[rhs[0]];
-            firstOfY1.erase(epsilon);
-            for (const auto& terminal : firstOfY1) {
-                if (firstSets[X].insert(terminal).second) {
-                    changed = true;
-                }
+            if (grew && !queued[to]) {
+                queued[to] = true;
+                worklist.push_back(to);
             }
-            
-            // If Y₁, Y₂, ..., Yᵢ₋₁ all have ε in their FIRST sets
-            bool allHaveEpsilon = firstSets[rhs[0]].count(epsilon) > 0;
-            for (size_t i = 1; i < rhs.size() && allHaveEpsilon; ++i) {
-                const GrammarSymbol& Yi = rhs[i];
-                
-                // Add FIRST(Yᵢ) - {ε} to FIRST(X)
-                std::set<GrammarSymbol> firstOfYi = firstSets[Yi];
-                firstOfYi.erase(epsilon);
-                for (const auto& terminal : firstOfYi) {
-                    if (firstSets[X].insert(terminal).second) {
-                        changed = true;
-                    }
-                }
-                
-                // Check if Yᵢ has ε
-                allHaveEpsilon = firstSets[Yi].count(epsilon) > 0;
+        }
+    }
+}
+
+} // namespace
+
+// FIRST set computation
+void Grammar::computeFirstSets() {
+    NumberedProductions numbered = numberProductions(*this);
+    size_t productionCount = numbered.lhs.size();
+    size_t count = nonTerminals.size();
+    setWords = (terminals.size() + 63) / 64;
+    
+    // Non-terminals that derive ε: a production does once every symbol of
+    // its right side is known to (a terminal never is), so each production
+    // counts the symbols still unknown and each non-terminal lists where it
+    // is used
+    std::vector<bool> nullable(count, false);
+    std::vector<uint32_t> unknown(productionCount);
+    std::vector<std::vector<uint32_t>> usedIn(count);
+    std::vector<uint32_t> worklist;
+    for (size_t p = 0; p < productionCount; ++p) {
+        unknown[p] = numbered.start[p + 1] - numbered.start[p];
+        for (uint32_t k = numbered.start[p]; k < numbered.start[p + 1]; ++k) {
+            if (!(numbered.symbols[k] & terminalFlag)) {
+                usedIn[numbered.symbols[k]].push_back(static_cast<uint32_t>(p));
             }
-            
-            // If all symbols in rhs have ε, add ε to FIRST(X)
-            if (allHaveEpsilon) {
-                if (firstSets[X].insert(epsilon).second) {
-                    changed = true;
-                }
+        }
+        if (unknown[p] == 0 && !nullable[numbered.lhs[p]]) {
+            nullable[numbered.lhs[p]] = true;
+            worklist.push_back(numbered.lhs[p]);
+        }
+    }
+    while (!worklist.empty()) {
+        uint32_t nt = worklist.back();
+        worklist.pop_back();
+        for (uint32_t p : usedIn[nt]) {
+            if (--unknown[p] == 0 && !nullable[numbered.lhs[p]]) {
+                nullable[numbered.lhs[p]] = true;
+                worklist.push_back(numbered.lhs[p]);
             }
-            
-            if (firstSets[X].size() > size_before) {
-                changed = true;
+        }
+    }
+    
+    // A → Y₁ Y₂ ...: FIRST(A) gets FIRST(Yᵢ) for every Yᵢ up to the first
+    // that does not derive ε. Terminals go straight in; a non-terminal Yᵢ
+    // is an edge Yᵢ → A to propagate along.
+    firstBits.assign(count * setWords, 0);
+    std::vector<std::vector<uint32_t>> edges(count);
+    for (size_t p = 0; p < productionCount; ++p) {
+        uint32_t lhs = numbered.lhs[p];
+        for (uint32_t k = numbered.start[p]; k < numbered.start[p + 1]; ++k) {
+            uint32_t symbol = numbered.symbols[k];
+            if (symbol & terminalFlag) {
+                size_t terminal = symbol & ~terminalFlag;
+                firstBits[lhs * setWords + terminal / 64] |= uint64_t(1) << (terminal % 64);
+                break;
+            }
+            if (symbol != lhs) {
+                edges[symbol].push_back(lhs);
             }
+            if (!nullable[symbol]) break;
         }
     }
+    propagate(firstBits, setWords, edges);
+    
+    // ε is added last, so it is not propagated to non-terminals that do
+    // not derive it
+    for (size_t nt = 0; nt < count; ++nt) {
+        if (nullable[nt]) {
+            firstBits[nt * setWords + epsilonIndex / 64] |= uint64_t(1) << (epsilonIndex % 64);
+        }
+    }
+    
+    firstSets.clear();
 }
 
 // FOLLOW set computation
 void Grammar::computeFollowSets() {
-    // Initialize FOLLOW sets
-    for (const auto& nonTerminal : nonTerminals) {
-        followSets[nonTerminal] = {};
+    NumberedProductions numbered = numberProductions(*this);
+    size_t count = nonTerminals.size();
+    std::vector<uint64_t> rest(setWords);
+    
+    // $ follows the start symbol
+    followBits.assign(count * setWords, 0);
+    size_t start = std::find(nonTerminals.begin(), nonTerminals.end(), startSymbol) - nonTerminals.begin();
+    if (start < count) {
+        followBits[start * setWords + endMarkerIndex / 64] |= uint64_t(1) << (endMarkerIndex % 64);
     }
     
-    // Add $ to FOLLOW(StartSymbol)
-    followSets[startSymbol].insert(endMarker);
-    
-    // Keep computing until no changes
-    bool changed = true;
-    while (changed) {
-        changed = false;
-        
-        for (const auto& production : productions) {
-            const GrammarSymbol& A = production.leftSide;
-            const std::vector<GrammarSymbol>& rhs = production.rightSide;
+    // A → α B β: FOLLOW(B) gets FIRST(β) - {ε}, and if β derives ε, FOLLOW(A)
+    // as an edge A → B. Right sides are walked backwards, keeping FIRST(β).
+    std::vector<std::vector<uint32_t>> edges(count);
+    for (size_t p = 0; p < numbered.lhs.size(); ++p) {
+        uint32_t lhs = numbered.lhs[p];
+        std::fill(rest.begin(), rest.end(), 0);
+        bool restNullable = true;
+        for (uint32_t k = numbered.start[p + 1]; k-- > numbered.start[p];) {
+            uint32_t symbol = numbered.symbols[k];
+            if (symbol & terminalFlag) {
+                size_t terminal = symbol & ~terminalFlag;
+                std::fill(rest.begin(), rest.end(), 0);
+                rest[terminal / 64] = uint64_t(1) << (terminal % 64);
+                restNullable = false;
+                continue;
+            }
             
-            for (size_t i = 0; i < rhs.size(); ++i) {
-                const GrammarSymbol& B = rhs[i];
-                
-                // Only interested in non-terminals
-                if (B.type != SymbolType::NON_TERMINAL) continue;
-                
-                size_t size_before = followSets[B].size();
-                
-                // If B is followed by another symbol in the production
-                if (i + 1 < rhs.size()) {
-                    const GrammarSymbol& next = rhs[i + 1];
-                    
-                    // Add FIRST(next) - {ε} to FOLLOW(B)
-                    std::set<GrammarSymbol> firstOfNext = firstSets[next];
-                    bool hasEpsilon = firstOfNext.count(epsilon) > 0;
-                    firstOfNext.erase(epsilon);
-                    
-                    for (const auto& symbol : firstOfNext) {
-                        followSets[B].insert(symbol);
-                    }
-                    
-                    // If FIRST(next) contains ε, add FOLLOW(A) to FOLLOW(B)
-                    if (hasEpsilon) {
-                        for (const auto& symbol : followSets[A]) {
-                            followSets[B].insert(symbol);
-                        }
-                    }
-                } 
-                // If B is the last symbol in the production or all symbols to the right derive ε
-                else {
-                    // Add FOLLOW(A) to FOLLOW(B)
-                    for (const auto& symbol : followSets[A]) {
-                        followSets[B].insert(symbol);
-                    }
-                }
-                
-                if (followSets[B].size() > size_before) {
-                    changed = true;
-                }
+            uint64_t* follow = &followBits[symbol * setWords];
+            for (size_t w = 0; w < setWords; ++w) {
+                follow[w] |= rest[w];
+            }
+            if (restNullable && symbol != lhs) {
+                edges[lhs].push_back(symbol);
             }
             
-            // Handle the case where multiple symbols after B can derive ε
-            for (int i = rhs.size() - 1; i >= 0; --i) {
-                const GrammarSymbol& B = rhs[i];
-                
-                if (B.type != SymbolType::NON_TERMINAL) break;
-                
-                bool allHaveEpsilon = true;
-                for (size_t j = i + 1; j < rhs.size(); ++j) {
-                    if (firstSets[rhs[j]].count(epsilon) == 0) {
-                        allHaveEpsilon = false;
-                        break;
-                    }
-                }
-                
-                if (allHaveEpsilon) {
-                    size_t size_before = followSets[B].size();
-                    
-                    // Add FOLLOW(A) to FOLLOW(B)
-                    for (const auto& symbol : followSets[A]) {
-                        followSets[B].insert(symbol);
-                    }
-                    
-                    if (followSets[B].size() > size_before) {
-                        changed = true;
-                    }
-                } else {
-                    break;
-                }
+            const uint64_t* first = &firstBits[symbol * setWords];
+            bool symbolNullable = first[epsilonIndex / 64] >> (epsilonIndex % 64) & 1;
+            for (size_t w = 0; w < setWords; ++w) {
+                rest[w] = symbolNullable ? rest[w] | first[w] : first[w];
             }
+            rest[epsilonIndex / 64] &= ~(uint64_t(1) << (epsilonIndex % 64));
+            restNullable = restNullable && symbolNullable;
         }
     }
+    propagate(followBits, setWords, edges);
+    
+    followSets.clear();
 }
 
 std::set<GrammarSymbol> Grammar::getFirstSetOfSequence(const std::vector<GrammarSymbol>& symbols) const {
@@ -452,22 +658,38 @@ std::set<GrammarSymbol> Grammar::getFirstSetOfSequence(const std::vector<Grammar
     return result;
 }
 
+// The set of a symbol from bitsets
+const std::set<GrammarSymbol>& Grammar::setFromBits(const GrammarSymbol& symbol, const std::vector<uint64_t>& bits,
+                                                    std::map<GrammarSymbol, std::set<GrammarSymbol>>& sets) const {
+    auto it = sets.find(symbol);
+    if (it != sets.end()) return it->second;
+    
+    static std::set<GrammarSymbol> emptySet;
+    if (setWords == 0 || bits.size() != nonTerminals.size() * setWords) return emptySet;
+    
+    size_t nt = std::find(nonTerminals.begin(), nonTerminals.end(), symbol) - nonTerminals.begin();
+    if (nt == nonTerminals.size()) return emptySet;
+    std::set<GrammarSymbol>& set = sets[symbol];
+    for (size_t terminal = 0; terminal < terminals.size(); ++terminal) {
+        if (bits[nt * setWords + terminal / 64] >> (terminal % 64) & 1) {
+            set.insert(terminals[terminal]);
+        }
+    }
+    return set;
+}
+
 const std::set<GrammarSymbol>& Grammar::getFirstSet(const GrammarSymbol& symbol) const {
-    auto it = firstSets.find(symbol);
-    if (it == firstSets.end()) {
-        static std::set<GrammarSymbol> emptySet;
-        return emptySet;
+    // FIRST of a terminal is the terminal itself, once FIRST is computed
+    if (symbol.type == SymbolType::TERMINAL && setWords > 0 &&
+        std::find(terminals.begin(), terminals.end(), symbol) != terminals.end()) {
+        auto it = firstSets.find(symbol);
+        return it != firstSets.end() ? it->second : firstSets[symbol] = {symbol};
     }
-    return it->second;
+    return setFromBits(symbol, firstBits, firstSets);
 }
 
 const std::set<GrammarSymbol>& Grammar::getFollowSet(const GrammarSymbol& symbol) const {
-    auto it = followSets.find(symbol);
-    if (it == followSets.end()) {
-        static std::set<GrammarSymbol> emptySet;
-        return emptySet;
-    }
-    return it->second;
+    return setFromBits(symbol, followBits, followSets);
 }
 
 void Grammar::printFirstSets() const {
@@ -1,12 +1,17 @@
 #ifndef GRAMMAR_H
 #define GRAMMAR_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <set>
 #include <map>
+#include <memory>
 #include <iostream>
 
+class GrammarCache;
+
 // Symbol types
 enum class SymbolType {
     TERMINAL,
@@ -61,21 +66,84 @@ private:
     std::vector<Production> productions;
     GrammarSymbol startSymbol;
     
-    // Maps for FIRST and FOLLOW sets
-    std::map<GrammarSymbol, std::set<GrammarSymbol>> firstSets;
-    std::map<GrammarSymbol, std::set<GrammarSymbol>> followSets;
+    // FIRST and FOLLOW sets of the non-terminals as bitsets over the
+    // terminals, setWords 64-bit words each, stored non-terminal by
+    // non-terminal (see getFirstBits)
+    size_t setWords;
+    std::vector<uint64_t> firstBits;
+    std::vector<uint64_t> followBits;
+    
+    // The same sets as symbols, built from the bitsets the first time
+    // getFirstSet or getFollowSet asks for one (a terminal's FIRST set is
+    // the terminal itself)
+    mutable std::map<GrammarSymbol, std::set<GrammarSymbol>> firstSets;
+    mutable std::map<GrammarSymbol, std::set<GrammarSymbol>> followSets;
+    
+    // The set of a non-terminal from bitsets, added to the map of symbol
+    // sets; empty if the bitsets are not computed
+    const std::set<GrammarSymbol>& setFromBits(const GrammarSymbol& symbol, const std::vector<uint64_t>& bits,
+                                               std::map<GrammarSymbol, std::set<GrammarSymbol>>& sets) const;
     
     // Special symbols
     GrammarSymbol epsilon;
     GrammarSymbol endMarker;
     
+    // True while the grammar is exactly the built-in one
+    bool builtin;
+    
+    // Copy the FIRST and FOLLOW sets computed at compile time
+    void loadBuiltinSets();
+    
+    // Cache of the grammar file the grammar was loaded from, if one was
+    // found for its text
+    std::shared_ptr<GrammarCache> cache;
+    
+    // Where to write a cache for the grammar file, and the hash of its text
+    // (no path if the grammar did not come from a file or has a cache)
+    std::string cachePath;
+    uint64_t textHash;
+    
+    // Forget the built-in or cached sets and table (the grammar changed)
+    void discardPrecomputed();
+    
+    // Add the symbols and productions of grammar text in the notation of
+    // grammar.txt (file is only used in error messages)
+    void parseGrammarText(std::string_view text, const std::string& file);
+    
+    // Copy symbols, productions and FIRST and FOLLOW sets from a cache
+    void loadFromCache(const GrammarCache& compiled);
+    
 public:
     // Constructor
     Grammar();
     
-    // Initialize the grammar for our simplified C-like language
+    // Initialize the grammar for our simplified C-like language, from the
+    // constexpr definition in builtin_grammar.h. FIRST and FOLLOW sets are
+    // loaded rather than computed.
     void initializeGrammar();
     
+    // Whether the grammar is the built-in one, whose sets and parse table
+    // were computed at compile time (adding anything clears it)
+    bool isBuiltin() const { return builtin; }
+    
+    // Replace the grammar with the one in a file written in the notation of
+    // grammar.txt. If FILE.cache was written for the same text, symbols,
+    // productions and sets come from it, and isCompiled() is true: no
+    // grammar analysis is needed. Throws std::runtime_error if the file
+    // cannot be read or has a syntax error.
+    void loadFromFile(const std::string& path);
+    
+    // Whether the grammar came from a cache, whose sets and parse table were
+    // computed by an earlier run (adding anything clears it)
+    bool isCompiled() const { return cache != nullptr; }
+    
+    // Parse table from the cache (laid out as Parser's), or nullptr
+    const int16_t* getCompiledTable() const;
+    
+    // Write the cache for a grammar loaded from a file, once its sets and
+    // parse table are computed (does nothing for other grammars)
+    void saveCompiledTable(const std::vector<int16_t>& parseTable);
+    
     // Add symbols
     void addTerminal(const std::string& name);
     void addNonTerminal(const std::string& name);
@@ -103,11 +171,24 @@ public:
     // Print the grammar
     void printGrammar() const;
     
-    // Compute FIRST and FOLLOW sets
+    // Compute FIRST and FOLLOW sets (FOLLOW needs FIRST)
     void computeFirstSets();
     void computeFollowSets();
     
-    // Get FIRST and FOLLOW sets
+    // FIRST and FOLLOW of non-terminal i of getNonTerminals(), as
+    // getSetWords() 64-bit words: bit j is terminal j of getTerminals(), so
+    // bit 0 (ε) of a FIRST set means the non-terminal derives ε. Valid once
+    // the sets are computed or loaded, which hasSets() tells.
+    bool hasSets() const {
+        return setWords > 0 && firstBits.size() == nonTerminals.size() * setWords &&
+               followBits.size() == firstBits.size();
+    }
+    size_t getSetWords() const { return setWords; }
+    const uint64_t* getFirstBits(size_t nonTerminal) const { return &firstBits[nonTerminal * setWords]; }
+    const uint64_t* getFollowBits(size_t nonTerminal) const { return &followBits[nonTerminal * setWords]; }
+    
+    // Get FIRST and FOLLOW sets as symbols (built on first use, so not
+    // safe to call from several threads at once)
     const std::set<GrammarSymbol>& getFirstSet(const GrammarSymbol& symbol) const;
     const std::set<GrammarSymbol>& getFollowSet(const GrammarSymbol& symbol) const;
     std::set<GrammarSymbol> getFirstSetOfSequence(const std::vector<GrammarSymbol>& symbols) const;
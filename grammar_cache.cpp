@@ -0,0 +1,199 @@
+#include "grammar_cache.h"
+#include "grammar.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+
+constexpr char GrammarCache::magic[4];
+
+// Hash of a grammar text
+uint64_t GrammarCache::hash(std::string_view text) {
+    uint64_t value = 14695981039346656037ull;
+    for (char c : text) {
+        value ^= static_cast<unsigned char>(c);
+        value *= 1099511628211ull;
+    }
+    return value;
+}
+
+// Map a cache file
+std::shared_ptr<GrammarCache> GrammarCache::open(const std::string& path, uint64_t textHash) {
+    auto file = SourceBuffer::fromFile(path);
+    if (!file || file->size() < sizeof(GrammarCacheHeader)) return nullptr;
+    
+    const auto* header = reinterpret_cast<const GrammarCacheHeader*>(file->data());
+    if (std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version ||
+        header->textHash != textHash) {
+        return nullptr;
+    }
+    
+    // Counts the symbol ids and the int16_t table can hold (non-terminal
+    // ids stay clear of Parser's terminal and action bits), and sets of
+    // exactly the words the terminals need
+    if (header->terminalCount < 2 || header->terminalCount > 0x4000 || header->nonTerminalCount == 0 ||
+        header->nonTerminalCount > 0x4000 || header->productionCount > 0x7FFF ||
+        header->setWords != (header->terminalCount + 63) / 64) {
+        return nullptr;
+    }
+    
+    // The arrays must fill the rest of the file exactly
+    size_t setBytes = size_t(header->nonTerminalCount) * header->setWords * sizeof(uint64_t);
+    size_t expected = sizeof(GrammarCacheHeader) + 2 * setBytes +
+                      (size_t(header->productionCount) + 1) * sizeof(uint32_t) +
+                      size_t(header->productionCount) * sizeof(uint16_t) +
+                      size_t(header->rhsCount) * sizeof(uint16_t) +
+                      size_t(header->nonTerminalCount) * header->terminalCount * sizeof(int16_t) +
+                      header->namesSize;
+    if (file->size() != expected) return nullptr;
+    
+    auto cache = std::make_shared<GrammarCache>();
+    const char* data = file->data() + sizeof(GrammarCacheHeader);
+    cache->header = header;
+    cache->first = reinterpret_cast<const uint64_t*>(data);
+    cache->follow = cache->first + size_t(header->nonTerminalCount) * header->setWords;
+    data += 2 * setBytes;
+    cache->rhsStart = reinterpret_cast<const uint32_t*>(data);
+    data += (size_t(header->productionCount) + 1) * sizeof(uint32_t);
+    cache->lhs = reinterpret_cast<const uint16_t*>(data);
+    data += size_t(header->productionCount) * sizeof(uint16_t);
+    cache->rhs = reinterpret_cast<const uint16_t*>(data);
+    data += size_t(header->rhsCount) * sizeof(uint16_t);
+    cache->table = reinterpret_cast<const int16_t*>(data);
+    data += size_t(header->nonTerminalCount) * header->terminalCount * sizeof(int16_t);
+    
+    // Split the names
+    const char* end = data + header->namesSize;
+    while (data < end) {
+        const char* nul = static_cast<const char*>(std::memchr(data, '\0', end - data));
+        if (!nul) return nullptr;
+        cache->names.emplace_back(data, nul - data);
+        data = nul + 1;
+    }
+    if (cache->names.size() != size_t(header->terminalCount) + header->nonTerminalCount ||
+        header->startSymbol >= header->nonTerminalCount || !cache->isConsistent()) {
+        return nullptr;
+    }
+    
+    cache->file = std::move(file);
+    return cache;
+}
+
+// Check everything a loaded grammar indexes with: the file can be edited
+// by anyone, so no id, offset or table entry in it is trusted
+bool GrammarCache::isConsistent() const {
+    size_t terminalCount = header->terminalCount;
+    size_t nonTerminalCount = header->nonTerminalCount;
+    size_t productionCount = header->productionCount;
+    
+    // Names: ε and $ first, then no empty or repeated ones
+    if (names[0] != "ε" || names[1] != "$") return false;
+    std::set<std::string_view> seen;
+    for (std::string_view name : names) {
+        if (name.empty() || !seen.insert(name).second) return false;
+    }
+    
+    // Productions: right sides in order, every id a known symbol (ε is left out)
+    if (rhsStart[0] != 0 || rhsStart[productionCount] != header->rhsCount) return false;
+    for (size_t p = 0; p < productionCount; ++p) {
+        if (rhsStart[p + 1] < rhsStart[p] || lhs[p] >= nonTerminalCount) return false;
+        for (const uint16_t* symbol = rhsBegin(p); symbol != rhsEnd(p); ++symbol) {
+            bool known = (*symbol & 0x8000) ? (*symbol & 0x7FFF) >= 1 && (*symbol & 0x7FFF) < terminalCount
+                                            : *symbol < nonTerminalCount;
+            if (!known) return false;
+        }
+    }
+    
+    // Table entries: no production, or one of the row's non-terminal
+    for (size_t nt = 0; nt < nonTerminalCount; ++nt) {
+        for (size_t terminal = 0; terminal < terminalCount; ++terminal) {
+            int16_t entry = table[nt * terminalCount + terminal];
+            if (entry < -1 || (entry >= 0 && (size_t(entry) >= productionCount || lhs[entry] != nt))) {
+                return false;
+            }
+        }
+    }
+    
+    // Sets: no bits past the last terminal
+    size_t words = header->setWords;
+    uint64_t lastWord = terminalCount % 64 == 0 ? ~uint64_t(0) : (uint64_t(1) << (terminalCount % 64)) - 1;
+    for (size_t nt = 0; nt < nonTerminalCount; ++nt) {
+        if ((first[nt * words + words - 1] & ~lastWord) != 0 || (follow[nt * words + words - 1] & ~lastWord) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Write the cache of a grammar
+bool GrammarCache::write(const std::string& path, uint64_t textHash, const Grammar& grammar,
+                         const std::vector<int16_t>& parseTable) {
+    const auto& terminals = grammar.getTerminals();
+    const auto& nonTerminals = grammar.getNonTerminals();
+    const auto& productions = grammar.getProductions();
+    
+    // Number the symbols as Parser does (and as the sets do)
+    std::map<std::string, uint16_t> ids;
+    std::string names;
+    for (size_t i = 0; i < terminals.size(); ++i) {
+        ids[terminals[i].name] = static_cast<uint16_t>(0x8000 | i);
+        names += terminals[i].name + '\0';
+    }
+    for (size_t i = 0; i < nonTerminals.size(); ++i) {
+        ids[nonTerminals[i].name] = static_cast<uint16_t>(i);
+        names += nonTerminals[i].name + '\0';
+    }
+    
+    GrammarCacheHeader header = {};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.setWords = static_cast<uint16_t>(grammar.getSetWords());
+    header.textHash = textHash;
+    header.terminalCount = static_cast<uint32_t>(terminals.size());
+    header.nonTerminalCount = static_cast<uint32_t>(nonTerminals.size());
+    header.productionCount = static_cast<uint32_t>(productions.size());
+    header.namesSize = static_cast<uint32_t>(names.size());
+    header.startSymbol = ids.at(grammar.getStartSymbol().name);
+    
+    // The grammar's bitsets, FIRST then FOLLOW
+    size_t words = nonTerminals.size() * header.setWords;
+    std::vector<uint64_t> sets;
+    if (words > 0) {
+        sets.assign(grammar.getFirstBits(0), grammar.getFirstBits(0) + words);
+        sets.insert(sets.end(), grammar.getFollowBits(0), grammar.getFollowBits(0) + words);
+    }
+    
+    // Productions without ε
+    std::vector<uint32_t> rhsStart(1, 0);
+    std::vector<uint16_t> lhs;
+    std::vector<uint16_t> rhs;
+    for (const auto& production : productions) {
+        lhs.push_back(ids.at(production.leftSide.name));
+        for (const auto& symbol : production.rightSide) {
+            if (symbol.name != "ε") {
+                rhs.push_back(ids.at(symbol.name));
+            }
+        }
+        rhsStart.push_back(static_cast<uint32_t>(rhs.size()));
+    }
+    header.rhsCount = static_cast<uint32_t>(rhs.size());
+    
+    // Write a temporary file and rename it, so a run reading the cache
+    // never sees half of one
+    std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) return false;
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(sets.data(), sizeof(uint64_t), sets.size(), file) == sets.size() &&
+                   std::fwrite(rhsStart.data(), sizeof(uint32_t), rhsStart.size(), file) == rhsStart.size() &&
+                   std::fwrite(lhs.data(), sizeof(uint16_t), lhs.size(), file) == lhs.size() &&
+                   std::fwrite(rhs.data(), sizeof(uint16_t), rhs.size(), file) == rhs.size() &&
+                   std::fwrite(parseTable.data(), sizeof(int16_t), parseTable.size(), file) == parseTable.size() &&
+                   std::fwrite(names.data(), 1, names.size(), file) == names.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,105 @@
+#ifndef GRAMMAR_CACHE_H
+#define GRAMMAR_CACHE_H
+
+#include "source_buffer.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Grammar;
+
+// File header of a grammar cache. The arrays follow it, largest elements
+// first so each one stays aligned:
+//
+//   uint64_t first[nonTerminalCount][setWords]     FIRST sets
+//   uint64_t follow[nonTerminalCount][setWords]    FOLLOW sets
+//   uint32_t rhsStart[productionCount + 1]         Production p's right side is
+//   uint16_t lhs[productionCount]                  rhs[rhsStart[p]] up to rhs[rhsStart[p + 1]]
+//   uint16_t rhs[rhsCount]
+//   int16_t  parseTable[nonTerminalCount][terminalCount]
+//   char     names[namesSize]                      Terminals, then non-terminals,
+//                                                  each ending in '\0'
+//
+// Symbols are numbered as Parser numbers them (non-terminal i is i,
+// terminal j is 0x8000 | j), and bit j of a set is terminal j, so bit 0
+// (ε) of a FIRST set means the non-terminal derives ε. Right sides leave
+// ε out.
+struct GrammarCacheHeader {
+    char magic[4];              // "GRMC"
+    uint16_t version;
+    uint16_t setWords;          // 64-bit words per terminal set
+    uint64_t textHash;          // Of the grammar text the cache was built from
+    uint32_t terminalCount;     // ε and $ included
+    uint32_t nonTerminalCount;
+    uint32_t productionCount;
+    uint32_t rhsCount;
+    uint32_t namesSize;
+    uint32_t startSymbol;       // Non-terminal index
+};
+
+static_assert(sizeof(GrammarCacheHeader) % 8 == 0, "GrammarCacheHeader should keep the sets aligned");
+
+// Compiled form of a grammar file: its symbols, productions, FIRST and
+// FOLLOW sets and LL(1) parse table, as an earlier run computed them. The
+// file is memory-mapped and read in place.
+class GrammarCache {
+private:
+    std::shared_ptr<SourceBuffer> file;
+    const GrammarCacheHeader* header;
+    const uint64_t* first;
+    const uint64_t* follow;
+    const uint32_t* rhsStart;
+    const uint16_t* lhs;
+    const uint16_t* rhs;
+    const int16_t* table;
+    std::vector<std::string_view> names;
+    
+    // Whether the ids, right-side offsets, table entries and sets are in range
+    bool isConsistent() const;
+    
+public:
+    static constexpr char magic[4] = {'G', 'R', 'M', 'C'};
+    static constexpr uint16_t version = 1;
+    
+    // Hash of a grammar text (64-bit FNV-1a)
+    static uint64_t hash(std::string_view text);
+    
+    // Map a cache file. Returns nullptr if there is none, it is not a
+    // grammar cache, it was built from a different text, or anything in it
+    // is out of range.
+    static std::shared_ptr<GrammarCache> open(const std::string& path, uint64_t textHash);
+    
+    // Write the cache of a grammar whose FIRST and FOLLOW sets are computed,
+    // with its parse table (laid out as Parser's). Returns false if the file
+    // cannot be written.
+    static bool write(const std::string& path, uint64_t textHash, const Grammar& grammar,
+                      const std::vector<int16_t>& parseTable);
+    
+    // Counts
+    size_t getTerminalCount() const { return header->terminalCount; }
+    size_t getNonTerminalCount() const { return header->nonTerminalCount; }
+    size_t getProductionCount() const { return header->productionCount; }
+    size_t getStartSymbol() const { return header->startSymbol; }
+    
+    // Names of terminal j and non-terminal i
+    std::string_view terminalName(size_t terminal) const { return names[terminal]; }
+    std::string_view nonTerminalName(size_t nonTerminal) const { return names[header->terminalCount + nonTerminal]; }
+    
+    // Production p: left side, and right side as symbol ids
+    uint16_t productionLhs(size_t production) const { return lhs[production]; }
+    const uint16_t* rhsBegin(size_t production) const { return rhs + rhsStart[production]; }
+    const uint16_t* rhsEnd(size_t production) const { return rhs + rhsStart[production + 1]; }
+    
+    // FIRST and FOLLOW sets, getSetWords() words per non-terminal, laid out
+    // as Grammar::getFirstBits
+    size_t getSetWords() const { return header->setWords; }
+    const uint64_t* firstBits() const { return first; }
+    const uint64_t* followBits() const { return follow; }
+    
+    // Parse table, nonTerminalCount rows of terminalCount entries
+    const int16_t* parseTable() const { return table; }
+};
+
+#endif // GRAMMAR_CACHE_H
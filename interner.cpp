@@ -0,0 +1,128 @@
+#include "interner.h"
+#include <cstring>
+
+namespace {
+
+// Bytes per storage block (longer names get a block of their own)
+const size_t nameBlockSize = 16 * 1024;
+
+// Initial number of hash slots (a power of two)
+const size_t initialSlots = 256;
+
+} // namespace
+
+// Constructor
+Interner::Interner() : slots(initialSlots, 0), blockUsed(0), blockSize(0) {}
+
+// Multiply-rotate hash over 8-byte words (identifiers are usually a word or three)
+uint32_t Interner::hash(std::string_view name) {
+    const uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+    uint64_t h = name.size() * multiplier;
+    const char* p = name.data();
+    size_t remaining = name.size();
+    
+    while (remaining >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        h = ((h ^ word) * multiplier);
+        h ^= h >> 29;
+        p += 8;
+        remaining -= 8;
+    }
+    if (remaining > 0) {
+        // Tail: reread the last 8 bytes when the name is long enough,
+        // which avoids a variable-length copy
+        uint64_t word = 0;
+        if (name.size() >= 8) {
+            std::memcpy(&word, name.data() + name.size() - 8, 8);
+        } else {
+            for (size_t i = 0; i < remaining; ++i) {
+                word |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+            }
+        }
+        h = ((h ^ word) * multiplier);
+        h ^= h >> 29;
+    }
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
+
+// Linear probing from the name's home slot
+size_t Interner::findSlot(std::string_view name, uint32_t h) const {
+    size_t mask = slots.size() - 1;
+    for (size_t i = h & mask;; i = (i + 1) & mask) {
+        uint32_t entry = slots[i];
+        if (entry == 0) return i;
+        if (hashes[entry - 1] == h && names[entry - 1] == name) return i;
+    }
+}
+
+// Double the table and reinsert every id
+void Interner::grow() {
+    slots.assign(slots.size() * 2, 0);
+    size_t mask = slots.size() - 1;
+    for (uint32_t id = 0; id < names.size(); ++id) {
+        size_t i = hashes[id] & mask;
+        while (slots[i] != 0) i = (i + 1) & mask;
+        slots[i] = id + 1;
+    }
+}
+
+// Copy a name into block storage
+std::string_view Interner::store(std::string_view name) {
+    if (blocks.empty() || blockUsed + name.size() > blockSize) {
+        blockSize = name.size() > nameBlockSize ? name.size() : nameBlockSize;
+        blocks.emplace_back(new char[blockSize]);
+        blockUsed = 0;
+    }
+    
+    char* dest = blocks.back().get() + blockUsed;
+    std::memcpy(dest, name.data(), name.size());
+    blockUsed += name.size();
+    return std::string_view(dest, name.size());
+}
+
+// Intern a name
+uint32_t Interner::intern(std::string_view name) {
+    uint32_t h = hash(name);
+    size_t slot = findSlot(name, h);
+    if (slots[slot] != 0) {
+        return slots[slot] - 1;
+    }
+    
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.push_back(store(name));
+    hashes.push_back(h);
+    slots[slot] = id + 1;
+    
+    // Keep the load factor at or below one half
+    if (names.size() * 2 > slots.size()) {
+        grow();
+    }
+    return id;
+}
+
+// Look up a name without adding it
+uint32_t Interner::find(std::string_view name) const {
+    uint32_t entry = slots[findSlot(name, hash(name))];
+    return entry != 0 ? entry - 1 : npos;
+}
+
+// Get the name of an id
+std::string_view Interner::name(uint32_t id) const {
+    return names[id];
+}
+
+// Number of names
+size_t Interner::size() const {
+    return names.size();
+}
+
+// Remove every name
+void Interner::clear() {
+    names.clear();
+    hashes.clear();
+    slots.assign(initialSlots, 0);
+    blocks.clear();
+    blockUsed = 0;
+    blockSize = 0;
+}
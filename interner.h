@@ -0,0 +1,59 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Identifier interner (atom table).
+// Each distinct name gets a dense id, starting at 0, the first time it is
+// interned. The lexer interns every IDENTIFIER it produces, so later stages
+// compare and index by id instead of hashing strings again. Names are copied
+// into blocks owned by the interner and stay valid as long as it does.
+class Interner {
+private:
+    std::vector<std::string_view> names;    // Name of each id
+    std::vector<uint32_t> hashes;           // Hash of each id, for rehashing
+    std::vector<uint32_t> slots;            // Open-addressed table of id + 1 (0 = empty)
+    
+    // Storage for the name bytes
+    std::vector<std::unique_ptr<char[]>> blocks;
+    size_t blockUsed;
+    size_t blockSize;
+    
+    static uint32_t hash(std::string_view name);
+    
+    // Slot holding name, or the empty slot where it would go
+    size_t findSlot(std::string_view name, uint32_t h) const;
+    
+    // Double the slot table
+    void grow();
+    
+    // Copy a name into the blocks
+    std::string_view store(std::string_view name);
+    
+public:
+    // Returned by find for names that were never interned
+    static constexpr uint32_t npos = UINT32_MAX;
+    
+    // Constructor
+    Interner();
+    
+    // Id of a name, adding it if it is new
+    uint32_t intern(std::string_view name);
+    
+    // Id of a name, or npos
+    uint32_t find(std::string_view name) const;
+    
+    // Name of an id
+    std::string_view name(uint32_t id) const;
+    
+    // Number of distinct names
+    size_t size() const;
+    
+    // Forget every name
+    void clear();
+};
+
+#endif // INTERNER_H
@@ -0,0 +1,395 @@
+#include "lalr_parser.h"
+#include "parser.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+namespace {
+
+// LR(0) item: production index and dot position in one integer, so a
+// kernel is a sorted vector of them
+uint32_t makeItem(size_t production, size_t dot) {
+    return static_cast<uint32_t>(production << 8 | dot);
+}
+
+size_t itemProduction(uint32_t item) {
+    return item >> 8;
+}
+
+size_t itemDot(uint32_t item) {
+    return item & 0xFF;
+}
+
+// Lookahead set: one bit per terminal
+using Lookahead = std::vector<uint64_t>;
+
+// Add the bits of `from` to `to`; true if any was new
+bool mergeLookahead(Lookahead& to, const Lookahead& from) {
+    bool grew = false;
+    for (size_t i = 0; i < to.size(); ++i) {
+        uint64_t merged = to[i] | from[i];
+        if (merged != to[i]) {
+            to[i] = merged;
+            grew = true;
+        }
+    }
+    return grew;
+}
+
+} // namespace
+
+// Constructor
+LalrParser::LalrParser(std::shared_ptr<LexicalAnalyzer> lex,
+                       std::shared_ptr<SymbolTable> symTab,
+                       std::shared_ptr<ErrorHandler> errHandler,
+                       std::shared_ptr<Grammar> gram)
+    : lexer(lex), symbolTable(symTab), errorHandler(errHandler), grammar(gram),
+      nonTerminalCount(0), terminalCount(0), stateCount(0), conflictCount(0), isInDeclaration(false) {}
+
+// Symbol ids, productions and tokenTerminals
+void LalrParser::numberSymbols() {
+    std::map<std::string, uint16_t> symbolIds;
+    nonTerminalNames.clear();
+    terminalNames.clear();
+    for (const auto& nonTerminal : grammar->getNonTerminals()) {
+        symbolIds[nonTerminal.name] = static_cast<uint16_t>(nonTerminalNames.size());
+        nonTerminalNames.push_back(nonTerminal.name);
+    }
+    for (const auto& terminal : grammar->getTerminals()) {
+        symbolIds[terminal.name] = static_cast<uint16_t>(terminalBit | terminalNames.size());
+        terminalNames.push_back(terminal.name);
+    }
+    nonTerminalCount = nonTerminalNames.size();
+    terminalCount = terminalNames.size();
+    
+    // Productions without ε, then the augmented start' → start
+    productionLhs.clear();
+    rhsSymbols.clear();
+    rhsStart.assign(1, 0);
+    for (const auto& production : grammar->getProductions()) {
+        productionLhs.push_back(symbolIds.at(production.leftSide.name));
+        for (const auto& symbol : production.rightSide) {
+            if (symbol.name != "ε") {
+                rhsSymbols.push_back(symbolIds.at(symbol.name));
+            }
+        }
+        rhsStart.push_back(static_cast<uint32_t>(rhsSymbols.size()));
+    }
+    productionLhs.push_back(static_cast<uint16_t>(nonTerminalCount));
+    rhsSymbols.push_back(symbolIds.at(grammar->getStartSymbol().name));
+    rhsStart.push_back(static_cast<uint32_t>(rhsSymbols.size()));
+    
+    // Each token type matches the terminal of the same name; the end of
+    // input matches the end marker
+    for (size_t t = 0; t < tokenTypeCount; ++t) {
+        auto it = symbolIds.find(Parser::tokenName(static_cast<TokenType>(t)));
+        tokenTerminals[t] = (it != symbolIds.end() && (it->second & terminalBit)) ? it->second : noSymbol;
+    }
+    tokenTerminals[static_cast<size_t>(TokenType::END_OF_FILE)] = symbolIds.at("$");
+}
+
+// Build the LALR(1) automaton and its tables
+void LalrParser::generateTables() {
+    numberSymbols();
+    size_t productionCount = productionLhs.size();
+    size_t augmented = productionCount - 1;
+    size_t words = (terminalCount + 63) / 64;
+    size_t endMarker = tokenTerminals[static_cast<size_t>(TokenType::END_OF_FILE)] & ~terminalBit;
+    
+    // FIRST of each non-terminal as a lookahead set (the grammar's bitsets
+    // use the same terminal numbering), and whether it derives ε (bit 0)
+    std::vector<Lookahead> first(nonTerminalCount);
+    std::vector<bool> nullable(nonTerminalCount, false);
+    for (size_t nt = 0; nt < nonTerminalCount; ++nt) {
+        const uint64_t* bits = grammar->getFirstBits(nt);
+        first[nt].assign(bits, bits + words);
+        nullable[nt] = first[nt][0] & 1;
+        first[nt][0] &= ~uint64_t(1);
+    }
+    
+    // Productions of each non-terminal
+    std::vector<std::vector<size_t>> productionsOf(nonTerminalCount + 1);
+    for (size_t p = 0; p < productionCount; ++p) {
+        productionsOf[productionLhs[p]].push_back(p);
+    }
+    
+    // States are found by their kernel, ignoring lookaheads, so states
+    // with the same core are merged as they are built (LALR rather than
+    // canonical LR(1)). A state is processed again whenever the
+    // lookaheads of its kernel grow, until nothing changes.
+    struct State {
+        std::vector<uint32_t> kernel;
+        std::vector<Lookahead> lookaheads;             // Per kernel item
+        std::vector<uint32_t> items;                   // Closure, after processing
+        std::vector<Lookahead> itemLookaheads;
+        std::vector<std::pair<uint16_t, uint16_t>> transitions;  // Symbol, target state
+    };
+    std::vector<State> states;
+    std::map<std::vector<uint32_t>, uint16_t> stateIds;
+    std::vector<uint16_t> worklist;
+    std::vector<bool> queued;
+    
+    auto addState = [&](std::vector<uint32_t> kernel, std::vector<Lookahead> lookaheads) {
+        auto found = stateIds.find(kernel);
+        if (found != stateIds.end()) {
+            State& state = states[found->second];
+            bool grew = false;
+            for (size_t i = 0; i < kernel.size(); ++i) {
+                grew |= mergeLookahead(state.lookaheads[i], lookaheads[i]);
+            }
+            if (grew && !queued[found->second]) {
+                queued[found->second] = true;
+                worklist.push_back(found->second);
+            }
+            return found->second;
+        }
+        uint16_t id = static_cast<uint16_t>(states.size());
+        stateIds.emplace(kernel, id);
+        states.push_back({std::move(kernel), std::move(lookaheads), {}, {}, {}});
+        queued.push_back(true);
+        worklist.push_back(id);
+        return id;
+    };
+    
+    Lookahead endOnly(words, 0);
+    endOnly[endMarker / 64] |= uint64_t(1) << (endMarker % 64);
+    addState({makeItem(augmented, 0)}, {endOnly});
+    
+    std::map<uint32_t, size_t> itemIndex;
+    while (!worklist.empty()) {
+        uint16_t id = worklist.back();
+        worklist.pop_back();
+        queued[id] = false;
+        
+        // Closure: [A → α · B β, a] adds [B → · γ, FIRST(β a)] for every B production
+        std::vector<uint32_t> items = states[id].kernel;
+        std::vector<Lookahead> itemLookaheads = states[id].lookaheads;
+        itemIndex.clear();
+        for (size_t i = 0; i < items.size(); ++i) {
+            itemIndex[items[i]] = i;
+        }
+        std::vector<size_t> pending(items.size());
+        for (size_t i = 0; i < pending.size(); ++i) {
+            pending[i] = i;
+        }
+        while (!pending.empty()) {
+            size_t i = pending.back();
+            pending.pop_back();
+            size_t p = itemProduction(items[i]);
+            size_t position = rhsStart[p] + itemDot(items[i]);
+            if (position == rhsStart[p + 1] || (rhsSymbols[position] & terminalBit)) continue;
+            
+            Lookahead follow(words, 0);
+            bool restNullable = true;
+            for (size_t k = position + 1; k < rhsStart[p + 1] && restNullable; ++k) {
+                uint16_t symbol = rhsSymbols[k];
+                if (symbol & terminalBit) {
+                    size_t terminal = symbol & ~terminalBit;
+                    follow[terminal / 64] |= uint64_t(1) << (terminal % 64);
+                    restNullable = false;
+                } else {
+                    mergeLookahead(follow, first[symbol]);
+                    restNullable = nullable[symbol];
+                }
+            }
+            if (restNullable) {
+                mergeLookahead(follow, itemLookaheads[i]);
+            }
+            
+            for (size_t q : productionsOf[rhsSymbols[position]]) {
+                uint32_t item = makeItem(q, 0);
+                auto found = itemIndex.find(item);
+                if (found == itemIndex.end()) {
+                    itemIndex[item] = items.size();
+                    items.push_back(item);
+                    itemLookaheads.push_back(follow);
+                    pending.push_back(items.size() - 1);
+                } else if (mergeLookahead(itemLookaheads[found->second], follow)) {
+                    pending.push_back(found->second);
+                }
+            }
+        }
+        
+        // Goto on each symbol after a dot: the kernel of the target state
+        std::map<uint16_t, std::map<uint32_t, Lookahead>> targets;
+        for (size_t i = 0; i < items.size(); ++i) {
+            size_t p = itemProduction(items[i]);
+            size_t position = rhsStart[p] + itemDot(items[i]);
+            if (position == rhsStart[p + 1]) continue;
+            auto& target = targets[rhsSymbols[position]];
+            auto inserted = target.emplace(items[i] + 1, itemLookaheads[i]);
+            if (!inserted.second) {
+                mergeLookahead(inserted.first->second, itemLookaheads[i]);
+            }
+        }
+        std::vector<std::pair<uint16_t, uint16_t>> transitions;
+        for (auto& target : targets) {
+            std::vector<uint32_t> kernel;
+            std::vector<Lookahead> lookaheads;
+            for (auto& item : target.second) {
+                kernel.push_back(item.first);
+                lookaheads.push_back(std::move(item.second));
+            }
+            transitions.emplace_back(target.first, addState(std::move(kernel), std::move(lookaheads)));
+        }
+        
+        State& state = states[id];
+        state.items = std::move(items);
+        state.itemLookaheads = std::move(itemLookaheads);
+        state.transitions = std::move(transitions);
+    }
+    
+    // State ids must fit a shift entry
+    if (states.size() > static_cast<size_t>(INT16_MAX) - 1) {
+        std::string errorMsg = "LALR(1) automaton has too many states (" + std::to_string(states.size()) + ")";
+        std::cerr << "Error: " << errorMsg << std::endl;
+        if (errorHandler) {
+            errorHandler->syntaxError(errorMsg, 0, 0);
+        }
+        actionTable.clear();
+        gotoTable.clear();
+        stateCount = 0;
+        return;
+    }
+    
+    // Shifts and gotos first, then reductions, so a shift/reduce conflict
+    // finds the shift already there
+    stateCount = states.size();
+    conflictCount = 0;
+    actionTable.assign(stateCount * terminalCount, 0);
+    gotoTable.assign(stateCount * nonTerminalCount, noSymbol);
+    for (size_t s = 0; s < stateCount; ++s) {
+        for (const auto& transition : states[s].transitions) {
+            if (transition.first & terminalBit) {
+                actionTable[s * terminalCount + (transition.first & ~terminalBit)] =
+                    static_cast<int16_t>(transition.second + 1);
+            } else {
+                gotoTable[s * nonTerminalCount + transition.first] = transition.second;
+            }
+        }
+    }
+    for (size_t s = 0; s < stateCount; ++s) {
+        const State& state = states[s];
+        for (size_t i = 0; i < state.items.size(); ++i) {
+            size_t p = itemProduction(state.items[i]);
+            if (rhsStart[p] + itemDot(state.items[i]) != rhsStart[p + 1]) continue;
+            
+            for (size_t terminal = 0; terminal < terminalCount; ++terminal) {
+                if (!(state.itemLookaheads[i][terminal / 64] >> (terminal % 64) & 1)) continue;
+                
+                int16_t& entry = actionTable[s * terminalCount + terminal];
+                int16_t reduce = static_cast<int16_t>(-static_cast<int>(p) - 1);
+                if (entry == 0) {
+                    entry = reduce;
+                } else if (entry > 0) {
+                    reportConflict(s, static_cast<uint16_t>(terminal), "shift/reduce", p);
+                } else if (entry != reduce) {
+                    size_t other = static_cast<size_t>(-entry - 1);
+                    reportConflict(s, static_cast<uint16_t>(terminal), "reduce/reduce", std::max(p, other));
+                    entry = static_cast<int16_t>(-static_cast<int>(std::min(p, other)) - 1);
+                }
+            }
+        }
+    }
+}
+
+// Production as text, for conflict messages
+std::string LalrParser::productionToString(size_t production) const {
+    uint16_t lhs = productionLhs[production];
+    std::string result = (lhs < nonTerminalCount ? nonTerminalNames[lhs] : nonTerminalNames[0] + "'") + " →";
+    if (rhsStart[production] == rhsStart[production + 1]) {
+        return result + " ε";
+    }
+    for (size_t k = rhsStart[production]; k < rhsStart[production + 1]; ++k) {
+        uint16_t symbol = rhsSymbols[k];
+        result += " " + ((symbol & terminalBit) ? terminalNames[symbol & ~terminalBit] : nonTerminalNames[symbol]);
+    }
+    return result;
+}
+
+// Report a conflict and the reduction that loses it
+void LalrParser::reportConflict(size_t state, uint16_t terminal, const std::string& kind, size_t production) {
+    ++conflictCount;
+    std::string errorMsg = "LALR(1) " + kind + " conflict in state " + std::to_string(state) + " on '" +
+                           terminalNames[terminal] + "', not reducing by " + productionToString(production);
+    std::cerr << "Warning: " << errorMsg << std::endl;
+    
+    if (errorHandler) {
+        errorHandler->syntaxError(errorMsg, 0, 0);
+    }
+}
+
+// Number of states of the automaton
+size_t LalrParser::getStateCount() const {
+    return stateCount;
+}
+
+// Number of conflicts found building it
+size_t LalrParser::getConflictCount() const {
+    return conflictCount;
+}
+
+// Parse the input
+bool LalrParser::parse() {
+    if (actionTable.empty()) {
+        generateTables();
+        if (actionTable.empty()) return false;
+    }
+    
+    size_t augmented = productionLhs.size() - 1;
+    stateStack.clear();
+    stateStack.push_back(0);
+    advance();
+    
+    while (true) {
+        uint16_t terminal = tokenTerminals[static_cast<size_t>(currentToken.type)];
+        int16_t action = terminal != noSymbol
+            ? actionTable[stateStack.back() * terminalCount + (terminal & ~terminalBit)]
+            : 0;
+        
+        if (action > 0) {
+            // Shift, tracking declarations the same way the table-driven parser does
+            if (currentToken.type == TokenType::INT || currentToken.type == TokenType::FLOAT) {
+                isInDeclaration = true;
+            } else if (currentToken.type == TokenType::SEMICOLON) {
+                isInDeclaration = false;
+            } else if (currentToken.type == TokenType::IDENTIFIER) {
+                handleIdentifier(currentToken);
+            }
+            stateStack.push_back(static_cast<uint16_t>(action - 1));
+            advance();
+        } else if (action < 0) {
+            // Reduce: pop the right side, then go to the state for the left side
+            size_t production = static_cast<size_t>(-action - 1);
+            if (production == augmented) {
+                return true;
+            }
+            stateStack.resize(stateStack.size() - (rhsStart[production + 1] - rhsStart[production]));
+            stateStack.push_back(gotoTable[stateStack.back() * nonTerminalCount + productionLhs[production]]);
+        } else {
+            std::string errorMsg = "Syntax error: unexpected token '" + std::string(currentToken.lexeme) + "'";
+            if (errorHandler) {
+                errorHandler->syntaxError(errorMsg, currentToken.offset);
+            }
+            return false;
+        }
+    }
+}
+
+// Advance to the next token
+void LalrParser::advance() {
+    currentToken = lexer->getNextToken();
+}
+
+// Handle identifier tokens based on context
+void LalrParser::handleIdentifier(const Token& token) {
+    if (isInDeclaration) {
+        // Only insert into symbol table if this is a declaration
+        symbolTable->insert(token.value, token.offset);
+    } else if (!symbolTable->exists(token.value)) {
+        if (errorHandler) {
+            errorHandler->semanticError("Use of undeclared variable '" + std::string(token.lexeme) + "'",
+                                        token.offset);
+        }
+    }
+}
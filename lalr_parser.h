@@ -0,0 +1,97 @@
+#ifndef LALR_PARSER_H
+#define LALR_PARSER_H
+
+#include "lexer.h"
+#include "symbol_table.h"
+#include "error_handler.h"
+#include "grammar.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Shift/reduce parser driven by LALR(1) ACTION and GOTO tables, built at
+// run time from the productions of a Grammar: the same ones Parser's LL(1)
+// table comes from. Where the LL(1) driver expands expr_tail/term_tail and
+// matches each operator through them, this one shifts tokens and reduces
+// whole right sides. It accepts the same inputs as Parser::parse for an
+// LL(1) grammar and does the same symbol table work. Like
+// RecursiveDescentParser, it writes no parsing trace or tree and stops at
+// the first syntax error.
+class LalrParser {
+private:
+    std::shared_ptr<LexicalAnalyzer> lexer;
+    std::shared_ptr<SymbolTable> symbolTable;
+    std::shared_ptr<ErrorHandler> errorHandler;
+    std::shared_ptr<Grammar> grammar;
+    
+    // Symbols are numbered as in Parser: non-terminal i of
+    // grammar->getNonTerminals() is i, and terminal j of
+    // grammar->getTerminals() is terminalBit | j. The augmented start
+    // symbol is non-terminal nonTerminalCount, and its production
+    // (start' → start) comes after the grammar's.
+    static constexpr uint16_t terminalBit = 0x8000;
+    static constexpr uint16_t noSymbol = 0xFFFF;
+    size_t nonTerminalCount;
+    size_t terminalCount;
+    std::vector<std::string> nonTerminalNames;
+    std::vector<std::string> terminalNames;
+    
+    // Productions: left side, and right side without ε. Production p is
+    // rhsSymbols[rhsStart[p]] up to rhsSymbols[rhsStart[p + 1]].
+    std::vector<uint16_t> productionLhs;
+    std::vector<uint16_t> rhsSymbols;
+    std::vector<uint32_t> rhsStart;
+    
+    // ACTION[state][terminal], stored row by row: 0 is an error, s + 1
+    // shifts and goes to state s, -(p + 1) reduces by production p (the
+    // augmented production accepts). GOTO[state][non-terminal] is the
+    // state after a reduction.
+    std::vector<int16_t> actionTable;
+    std::vector<uint16_t> gotoTable;
+    size_t stateCount;
+    size_t conflictCount;
+    
+    // Terminal each TokenType matches, or noSymbol
+    static constexpr size_t tokenTypeCount = static_cast<size_t>(TokenType::ERROR) + 1;
+    std::array<uint16_t, tokenTypeCount> tokenTerminals;
+    
+    // States of the parse, top at the back. The capacity is kept across parses.
+    std::vector<uint16_t> stateStack;
+    
+    // Current token
+    Token currentToken;
+    
+    // State tracking (as in Parser)
+    bool isInDeclaration;
+    
+    void numberSymbols();  // Symbol ids, productions and tokenTerminals
+    std::string productionToString(size_t production) const;
+    void reportConflict(size_t state, uint16_t terminal, const std::string& kind, size_t production);
+    void advance();
+    void handleIdentifier(const Token& token);  // Handle identifier tokens based on context
+    
+public:
+    // Constructor
+    LalrParser(std::shared_ptr<LexicalAnalyzer> lex,
+               std::shared_ptr<SymbolTable> symTab,
+               std::shared_ptr<ErrorHandler> errHandler,
+               std::shared_ptr<Grammar> gram);
+    
+    // Build the LALR(1) automaton and its tables. The grammar's FIRST sets
+    // must be computed, as for Parser::generateParseTable. Conflicts are
+    // reported to the error handler and resolved as yacc does: shift over
+    // reduce, and the earlier production of two reductions.
+    void generateTables();
+    
+    // Number of states of the automaton, and of conflicts found building it
+    size_t getStateCount() const;
+    size_t getConflictCount() const;
+    
+    // Parse the input (building the tables first if needed); stops at the
+    // first syntax error
+    bool parse();
+};
+
+#endif // LALR_PARSER_H
@@ -1,17 +1,69 @@
 #include "lexer.h"
 #include "symbol_table.h"
 #include "error_handler.h"
+#include "source_buffer.h"
+#include "lexer_tables.h"
+#include "lexer_simd.h"
 #include <iostream>
 #include <cctype>
 #include <regex>
 #include <fstream>
 #include <sstream>
+#include <array>
+#include <thread>
+#include <algorithm>
+#include <charconv>
 
 // Static initialization
 std::map<std::string, TokenType> LexicalAnalyzer::keywords;
 
+namespace {
+
+// Character classes used to skip whitespace and comments and to check
+// word boundaries after a DFA match
+enum CharClass : unsigned char {
+    CC_OTHER,       // Anything else
+    CC_SPACE,       // ' ', '\t', '\r'
+    CC_NEWLINE,     // '\n'
+    CC_IDENT,       // [a-zA-Z_]
+    CC_DIGIT,       // [0-9]
+    CC_SLASH        // '/', possibly the start of a comment
+};
+
+struct ScannerTables {
+    std::array<unsigned char, 256> charClass;
+    
+    ScannerTables() {
+        charClass.fill(CC_OTHER);
+        
+        charClass[' '] = CC_SPACE;
+        charClass['\t'] = CC_SPACE;
+        charClass['\r'] = CC_SPACE;
+        charClass['\n'] = CC_NEWLINE;
+        
+        for (int c = 'a'; c <= 'z'; ++c) charClass[c] = CC_IDENT;
+        for (int c = 'A'; c <= 'Z'; ++c) charClass[c] = CC_IDENT;
+        charClass['_'] = CC_IDENT;
+        for (int c = '0'; c <= '9'; ++c) charClass[c] = CC_DIGIT;
+        
+        charClass['/'] = CC_SLASH;
+    }
+};
+
+const ScannerTables scannerTables;
+
+inline unsigned char classOf(char c) {
+    return scannerTables.charClass[static_cast<unsigned char>(c)];
+}
+
+inline bool isWordClass(unsigned char cc) {
+    return cc == CC_IDENT || cc == CC_DIGIT;
+}
+
+} // namespace
+
 // Token to string conversion for debugging
-std::string Token::toString() const {
+std::string Token::toString(const SourceLocation& location) const {
     std::string typeStr;
     
     switch (type) {
@@ -41,8 +93,8 @@ std::string Token::toString() const {
         case TokenType::ERROR: typeStr = "ERROR"; break;
     }
     
-    return "Token(" + typeStr + ", '" + lexeme + "', line=" + 
-           std::to_string(line) + ", col=" + std::to_string(column) + ")";
+    return "Token(" + typeStr + ", '" + std::string(lexeme) + "', line=" + 
+           std::to_string(location.line) + ", col=" + std::to_string(location.column) + ")";
 }
 
 // Get just the token type as string
@@ -76,6 +128,76 @@ std::string Token::getTypeAsString() const {
     }
 }
 
+// Set the text the token offsets refer to
+void TokenStore::setSource(std::string_view source, const LineIndex* lineIndex) {
+    text = source;
+    lines = lineIndex;
+}
+
+// Remove all tokens
+void TokenStore::clear() {
+    types.clear();
+    offsets.clear();
+    lengths.clear();
+    values.clear();
+}
+
+// Reserve space for a number of tokens
+void TokenStore::reserve(size_t count) {
+    types.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+    values.reserve(count);
+}
+
+// Append a token
+void TokenStore::push(TokenType type, uint32_t offset, uint32_t length, uint32_t value) {
+    types.push_back(static_cast<uint8_t>(type));
+    offsets.push_back(offset);
+    lengths.push_back(length);
+    values.push_back(value);
+}
+
+// Replace a range of tokens
+void TokenStore::splice(size_t first, size_t last, const TokenStore& replacement, int64_t shift) {
+    for (size_t i = last; i < offsets.size(); ++i) {
+        offsets[i] = static_cast<uint32_t>(offsets[i] + shift);
+    }
+    
+    // Grow or shrink the range with a single move of the tail, then overwrite it
+    auto replaceRange = [first, last](auto& column, const auto& with) {
+        size_t removed = last - first;
+        if (with.size() > removed) {
+            column.insert(column.begin() + last, with.size() - removed, {});
+        } else if (with.size() < removed) {
+            column.erase(column.begin() + first + with.size(), column.begin() + last);
+        }
+        std::copy(with.begin(), with.end(), column.begin() + first);
+    };
+    replaceRange(types, replacement.types);
+    replaceRange(offsets, replacement.offsets);
+    replaceRange(lengths, replacement.lengths);
+    replaceRange(values, replacement.values);
+}
+
+// Line and column of a token
+SourceLocation TokenStore::location(size_t index) const {
+    return lines ? lines->resolve(offsets[index]) : SourceLocation();
+}
+
+// Build a Token for one entry
+Token TokenStore::token(size_t index) const {
+    return Token(type(index), lexeme(index), offsets[index], values[index]);
+}
+
+// Bytes held by the token arrays
+size_t TokenStore::memoryUsage() const {
+    return types.capacity() * sizeof(uint8_t) +
+           offsets.capacity() * sizeof(uint32_t) +
+           lengths.capacity() * sizeof(uint32_t) +
+           values.capacity() * sizeof(uint32_t);
+}
+
 // Initialize keywords map
 void LexicalAnalyzer::initKeywords() {
     if (keywords.empty()) {
@@ -89,20 +211,41 @@ void LexicalAnalyzer::initKeywords() {
 // Constructor
 LexicalAnalyzer::LexicalAnalyzer(std::shared_ptr<SymbolTable> symTable, 
                                 std::shared_ptr<ErrorHandler> errHandler)
-    : position(0), line(1), column(1), 
-      symbolTable(symTable), errorHandler(errHandler) {
+    : position(0), inputOffset(0), lineIndex(std::make_shared<LineIndex>()), mode(LexerMode::TABLE),
+      atInputEnd(true), openComment(OpenComment::NONE), openCommentOffset(0),
+      commentRanToEnd(false), tokenMayContinue(false), scanExtent(0), lazy(false), readPosition(0),
+      threadCount(1), parallelMinBytes(1 << 20), interner(std::make_shared<Interner>()),
+      constants(std::make_shared<ConstantPool>()) {
     initKeywords();
-    initPatterns();
+    setSymbolTable(symTable);
+    setErrorHandler(errHandler);
 }
 
 // Set symbol table
 void LexicalAnalyzer::setSymbolTable(std::shared_ptr<SymbolTable> symTable) {
     symbolTable = symTable;
+    if (symbolTable) {
+        symbolTable->setLineIndex(lineIndex);
+        interner = symbolTable->getInterner();
+    }
 }
 
 // Set error handler
 void LexicalAnalyzer::setErrorHandler(std::shared_ptr<ErrorHandler> errHandler) {
     errorHandler = errHandler;
+    if (errorHandler) {
+        errorHandler->setLineIndex(lineIndex);
+    }
+}
+
+// Set scanning strategy
+void LexicalAnalyzer::setMode(LexerMode m) {
+    mode = m;
+}
+
+// Get scanning strategy
+LexerMode LexicalAnalyzer::getMode() const {
+    return mode;
 }
 
 // Initialize regex patterns
@@ -142,8 +285,9 @@ void LexicalAnalyzer::initPatterns() {
 
 // Tokenize a file
 void LexicalAnalyzer::tokenizeFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+    // Map the file (or read it once) straight into the source buffer
+    std::shared_ptr<SourceBuffer> src = SourceBuffer::fromFile(filename);
+    if (!src) {
         if (errorHandler) {
             errorHandler->lexicalError("Could not open file " + filename, 0, 0);
         } else {
@@ -152,10 +296,10 @@ void LexicalAnalyzer::tokenizeFile(const std::string& filename) {
         return;
     }
     
-    // Read the entire file into a string
-    std::string content((std::istreambuf_iterator<char>(file)),
-                         std::istreambuf_iterator<char>());
-    tokenizeString(content);
+    tokenizeSource(src);
+    
+    // In lazy mode no tokens exist yet, so there is nothing to write
+    if (lazy) return;
     
     // Create output directory if it doesn't exist
     #ifdef _WIN32
@@ -171,30 +315,82 @@ void LexicalAnalyzer::tokenizeFile(const std::string& filename) {
 
 // Tokenize a string
 void LexicalAnalyzer::tokenizeString(const std::string& input) {
-    inputBuffer = input;
-    position = 0;
-    line = 1;
-    column = 1;
-    tokenStream.clear();
+    tokenizeSource(std::make_shared<SourceBuffer>(input));
+}
+
+// Get the source buffer
+std::shared_ptr<SourceBuffer> LexicalAnalyzer::getSource() const {
+    return source;
+}
+
+// Get the line index
+std::shared_ptr<const LineIndex> LexicalAnalyzer::getLineIndex() const {
+    return lineIndex;
+}
+
+// Get the interner
+std::shared_ptr<Interner> LexicalAnalyzer::getInterner() const {
+    return interner;
+}
+
+// Get the constant pool
+std::shared_ptr<ConstantPool> LexicalAnalyzer::getConstantPool() const {
+    return constants;
+}
+
+// Resolve a token offset
+SourceLocation LexicalAnalyzer::locate(size_t offset) const {
+    return lineIndex->resolve(offset);
+}
+
+// Tokenize a source buffer
+void LexicalAnalyzer::tokenizeSource(std::shared_ptr<SourceBuffer> src) {
+    source = src;
+    inputBuffer = source->view();
+    resetScanner();
+    tokens.clear();
+    tokens.setSource(inputBuffer, lineIndex.get());
+    lookahead.clear();
+    readPosition = 0;
+    
+    // Token offsets are 32-bit; larger inputs have to be streamed
+    if (inputBuffer.length() > UINT32_MAX) {
+        if (errorHandler) {
+            errorHandler->lexicalError("Input is larger than 4 GiB; use streaming mode", 0, 0);
+        }
+        inputBuffer = std::string_view();
+        tokens.setSource(inputBuffer, lineIndex.get());
+        tokens.push(TokenType::END_OF_FILE, 0, 0, 0);
+        return;
+    }
+    
+    // The regex patterns are only compiled when the reference matcher is used
+    if (mode == LexerMode::REGEX && patterns.empty()) {
+        initPatterns();
+    }
+    
+    // Lazy mode: tokens are produced on demand by getNextToken
+    if (lazy) return;
+    
+    if (threadCount > 1 && mode == LexerMode::TABLE && inputBuffer.length() >= parallelMinBytes) {
+        tokenizeParallel();
+        return;
+    }
     
     bool hasLexicalErrors = false;
     
-    while (position < inputBuffer.length()) {
-        skipWhitespaceAndComments();
-        if (position >= inputBuffer.length()) break;
-        
-        Token token = findNextToken();
-        tokenStream.push_back(token);
+    while (true) {
+        Token token = lexNextToken();
+        if (token.type == TokenType::END_OF_FILE) break;
         
-        // If error token, report it
+        storeToken(token);
         if (token.type == TokenType::ERROR && errorHandler) {
-            errorHandler->lexicalError("Invalid token: '" + token.lexeme + "'", token.line, token.column);
             hasLexicalErrors = true;
         }
     }
     
     // Add EOF token
-    tokenStream.push_back(Token(TokenType::END_OF_FILE, "", line, column));
+    tokens.push(TokenType::END_OF_FILE, static_cast<uint32_t>(inputBuffer.length()), 0, 0);
     
     // Only report lexical errors if there were actual lexical errors
     if (hasLexicalErrors && errorHandler) {
@@ -202,6 +398,211 @@ void LexicalAnalyzer::tokenizeString(const std::string& input) {
     }
 }
 
+// Reset scanning state for new input
+void LexicalAnalyzer::resetScanner() {
+    position = 0;
+    inputOffset = 0;
+    lineIndex->clear();
+    atInputEnd = true;
+    openComment = OpenComment::NONE;
+    commentRanToEnd = false;
+    tokenMayContinue = false;
+}
+
+// Re-lex the part of the source an edit can affect
+bool LexicalAnalyzer::applyEdit(size_t offset, size_t removedLength, std::string_view insertedText) {
+    if (!source || lazy || offset > inputBuffer.length() ||
+        removedLength > inputBuffer.length() - offset ||
+        inputBuffer.length() - removedLength + insertedText.length() > UINT32_MAX) {
+        return false;
+    }
+    
+    // Find the first token ending after the edit start (never past EOF)
+    size_t low = 0;
+    size_t high = tokens.size() - 1;
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        if (static_cast<size_t>(tokens.offset(mid)) + tokens.length(mid) > offset) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    
+    // Tokens before it can still depend on the edited bytes, because the
+    // scanner may look past the end of a token (up to the 'x' in "1.5x",
+    // which lexes as "1"). No scan gets past the first whitespace or comment
+    // after its start, so only the run of adjacent tokens before the edit
+    // needs checking: rescan each on the old text to see how far it looked.
+    size_t first = low;
+    for (size_t k = low; k > 0; --k) {
+        position = tokens.offset(k - 1);
+        atInputEnd = true;
+        scanToken();
+        if (scanExtent > offset) {
+            first = k - 1;
+        }
+        if (k - 1 == 0 || tokens.offset(k - 2) + tokens.length(k - 2) < tokens.offset(k - 1)) {
+            break;
+        }
+    }
+    
+    // The end of the token before it is outside any comment, so the
+    // scanner can restart there
+    const size_t restart = first > 0 ? tokens.offset(first - 1) + tokens.length(first - 1) : 0;
+    const int64_t shift = static_cast<int64_t>(insertedText.length()) - static_cast<int64_t>(removedLength);
+    const size_t editEnd = offset + insertedText.length();
+    
+    source->replace(offset, removedLength, insertedText);
+    inputBuffer = source->view();
+    tokens.setSource(inputBuffer, lineIndex.get());
+    std::vector<size_t> oldLines = lineIndex->splitAfter(restart);
+    
+    position = restart;
+    inputOffset = 0;
+    atInputEnd = true;
+    openComment = OpenComment::NONE;
+    commentRanToEnd = false;
+    tokenMayContinue = false;
+    
+    // Scan until a token starts, past the edit, where an old token started:
+    // from there on the text, and so the token stream, is the old one shifted
+    TokenStore fresh;
+    size_t resume = tokens.size();
+    size_t candidate = first;
+    while (true) {
+        Token token = lexNextToken();
+        if (token.type == TokenType::END_OF_FILE) {
+            fresh.push(TokenType::END_OF_FILE, static_cast<uint32_t>(inputBuffer.length()), 0, 0);
+            break;
+        }
+        
+        if (token.offset >= editEnd) {
+            size_t oldOffset = static_cast<size_t>(static_cast<int64_t>(token.offset) - shift);
+            while (candidate < tokens.size() && tokens.offset(candidate) < oldOffset) {
+                candidate++;
+            }
+            if (candidate < tokens.size() && tokens.offset(candidate) == oldOffset) {
+                resume = candidate;
+                break;
+            }
+        }
+        
+        fresh.push(token.type, static_cast<uint32_t>(token.offset),
+                   static_cast<uint32_t>(token.lexeme.length()), token.value);
+    }
+    
+    // Lines after the resume point are the old ones, shifted
+    if (resume < tokens.size()) {
+        size_t resumeOffset = tokens.offset(resume);
+        for (size_t lineStart : oldLines) {
+            if (lineStart > resumeOffset) {
+                lineIndex->addLineStart(static_cast<size_t>(static_cast<int64_t>(lineStart) + shift));
+            }
+        }
+    }
+    
+    lastEdit.first = first;
+    lastEdit.removed = resume - first;
+    lastEdit.inserted = fresh.size();
+    tokens.splice(first, resume, fresh, shift);
+    
+    position = inputBuffer.length();
+    lookahead.clear();
+    readPosition = 0;
+    return true;
+}
+
+// Get the range changed by the last edit
+const TokenEdit& LexicalAnalyzer::getLastEdit() const {
+    return lastEdit;
+}
+
+// Append a token to the store
+void LexicalAnalyzer::storeToken(const Token& token) {
+    tokens.push(token.type, static_cast<uint32_t>(token.lexeme.data() - inputBuffer.data()),
+                static_cast<uint32_t>(token.lexeme.length()), token.value);
+}
+
+// Tokenize a file through a sliding window
+bool LexicalAnalyzer::tokenizeStream(const std::string& filename,
+                                     const std::function<void(const Token&)>& onToken,
+                                     size_t windowSize) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        if (errorHandler) {
+            errorHandler->lexicalError("Could not open file " + filename, 0, 0);
+        }
+        return false;
+    }
+    
+    std::string window(windowSize > 0 ? windowSize : 1, '\0');
+    size_t filled = 0;
+    
+    source.reset();
+    tokens.clear();
+    tokens.setSource(std::string_view(), lineIndex.get());
+    resetScanner();
+    atInputEnd = false;
+    
+    // Keep the unconsumed tail of the window, then read more input behind it
+    auto refill = [&]() {
+        // Lines behind the window are no longer needed, except where an
+        // open comment started (it is reported if never closed)
+        inputOffset += position;
+        size_t keepFrom = (openComment == OpenComment::BLOCK) ? std::min(openCommentOffset, inputOffset)
+                                                              : inputOffset;
+        lineIndex->discardBefore(keepFrom);
+        
+        size_t kept = filled - position;
+        std::copy(window.begin() + position, window.begin() + filled, window.begin());
+        if (kept == window.size()) {
+            // A single token fills the whole window
+            window.resize(window.size() * 2);
+        }
+        
+        file.read(&window[kept], static_cast<std::streamsize>(window.size() - kept));
+        size_t count = static_cast<size_t>(file.gcount());
+        filled = kept + count;
+        position = 0;
+        if (count == 0) atInputEnd = true;
+        inputBuffer = std::string_view(window.data(), filled);
+    };
+    
+    refill();
+    while (true) {
+        if (!skipWhitespace() || (position >= inputBuffer.length() && !atInputEnd)) {
+            refill();
+            continue;
+        }
+        if (position >= inputBuffer.length()) break;
+        
+        const size_t tokenStart = position;
+        Token token = scanToken();
+        
+        // The match may continue in the next window: rescan it after refilling
+        if (tokenMayContinue) {
+            position = tokenStart;
+            refill();
+            continue;
+        }
+        
+        if (token.type == TokenType::IDENTIFIER) {
+            token.value = interner->intern(token.lexeme);
+        } else if (token.type == TokenType::INTEGER_LITERAL || token.type == TokenType::FLOAT_LITERAL) {
+            token.value = convertLiteral(token);
+        }
+        onToken(token);
+        if (token.type == TokenType::ERROR && errorHandler) {
+            errorHandler->lexicalError("Invalid token: '" + std::string(token.lexeme) + "'", token.offset);
+        }
+    }
+    
+    onToken(Token(TokenType::END_OF_FILE, "", inputOffset + position));
+    inputBuffer = std::string_view();
+    return true;
+}
+
 // Skip whitespace and comments
 void LexicalAnalyzer::skipWhitespaceAndComments() {
     static const std::regex whitespaceRegex("^[ \t\r\n]+");
@@ -211,45 +612,31 @@ void LexicalAnalyzer::skipWhitespaceAndComments() {
     bool continueSkipping = true;
     while (position < inputBuffer.length() && continueSkipping) {
         continueSkipping = false;
-        std::string remaining = inputBuffer.substr(position);
+        std::string_view remaining = inputBuffer.substr(position);
+        const char* first = remaining.data();
+        const char* last = first + remaining.size();
         
         // Try to match whitespace
-        std::smatch match;
-        if (std::regex_search(remaining, match, whitespaceRegex, std::regex_constants::match_continuous)) {
-            std::string matched = match.str();
-            // Count newlines for line tracking
-            for (char c : matched) {
-                if (c == '\n') {
-                    line++;
-                    column = 1;
-                } else {
-                    column++;
-                }
-            }
+        std::cmatch match;
+        if (std::regex_search(first, last, match, whitespaceRegex, std::regex_constants::match_continuous)) {
+            std::string_view matched = remaining.substr(0, match.length());
+            recordNewlines(matched);
             position += matched.length();
             continueSkipping = true;
         }
         
         // Try to match single-line comment
-        else if (std::regex_search(remaining, match, singleLineCommentRegex, std::regex_constants::match_continuous)) {
-            std::string matched = match.str();
+        else if (std::regex_search(first, last, match, singleLineCommentRegex, std::regex_constants::match_continuous)) {
+            std::string_view matched = remaining.substr(0, match.length());
             position += matched.length();
             continueSkipping = true;
-            // No need to update line since we'll hit the newline in whitespace matching
+            // The newline itself is left for the whitespace match
         }
         
         // Try to match multi-line comment
-        else if (std::regex_search(remaining, match, multiLineCommentRegex, std::regex_constants::match_continuous)) {
-            std::string matched = match.str();
-            // Count newlines in the comment
-            for (char c : matched) {
-                if (c == '\n') {
-                    line++;
-                    column = 1;
-                } else {
-                    column++;
-                }
-            }
+        else if (std::regex_search(first, last, match, multiLineCommentRegex, std::regex_constants::match_continuous)) {
+            std::string_view matched = remaining.substr(0, match.length());
+            recordNewlines(matched);
             position += matched.length();
             continueSkipping = true;
         }
@@ -258,67 +645,340 @@ void LexicalAnalyzer::skipWhitespaceAndComments() {
 
 // Find the next token
 Token LexicalAnalyzer::findNextToken() {
-    std::string remaining = inputBuffer.substr(position);
+    std::string_view remaining = inputBuffer.substr(position);
     
     // Try to match each pattern
     for (const auto& pattern : patterns) {
-        std::smatch match;
-        if (std::regex_search(remaining, match, std::regex(pattern.pattern), 
-                            std::regex_constants::match_continuous)) {
-            std::string matched = match.str();
+        std::cmatch match;
+        if (std::regex_search(remaining.data(), remaining.data() + remaining.size(), match,
+                            std::regex(pattern.pattern), std::regex_constants::match_continuous)) {
+            std::string_view matched = remaining.substr(0, match.length());
             
             // Create token
-            Token token(pattern.type, matched, line, column);
-            
-            // Update position and column
+            Token token(pattern.type, matched, inputOffset + position);
             position += matched.length();
-            column += matched.length();
-            
             return token;
         }
     }
     
     // If no pattern matches, return error token
-    std::string errorChar = remaining.substr(0, 1);
-    Token errorToken(TokenType::ERROR, errorChar, line, column);
+    std::string_view errorChar = remaining.substr(0, 1);
+    Token errorToken(TokenType::ERROR, errorChar, inputOffset + position);
     position++;
-    column++;
     return errorToken;
 }
 
+// Scan the next token by running the generated DFA (one table lookup per
+// byte) and keeping the longest accepted prefix. Numbers are then checked
+// against the word boundaries the regex patterns required, so the token
+// stream matches LexerMode::REGEX.
+Token LexicalAnalyzer::scanToken() {
+    const size_t start = position;
+    const size_t length = inputBuffer.length();
+    const char* input = inputBuffer.data();
+    
+    unsigned char state = LexerTables::startState;
+    TokenType type = TokenType::ERROR;
+    size_t end = start;
+    
+    size_t p = start;
+    for (; p < length; ++p) {
+        state = LexerTables::transitions[state][static_cast<unsigned char>(input[p])];
+        if (state == LexerTables::deadState) break;
+        if (LexerTables::acceptType[state] != TokenType::ERROR) {
+            type = LexerTables::acceptType[state];
+            end = p + 1;
+        }
+        
+        // Past any keyword prefix: the rest of the identifier can be skipped in bulk
+        if (state == LexerTables::identifierRunState) {
+            end = p = LexerSimd::skipIdentifierChars(input + end, input + length) - input;
+            break;
+        }
+    }
+    
+    // Reaching the end of a streaming window means the match (or the word
+    // boundary check below) may depend on bytes that have not been read yet
+    tokenMayContinue = !atInputEnd && p >= length;
+    scanExtent = p < length ? p + 1 : length + 1;
+    
+    if (end < length && isWordClass(classOf(input[end]))) {
+        // A float must end on a word boundary, otherwise fall back to the integer part
+        if (type == TokenType::FLOAT_LITERAL) {
+            end = inputBuffer.find('.', start);
+            type = TokenType::INTEGER_LITERAL;
+        }
+        // Digits running straight into letters match no pattern
+        else if (type == TokenType::INTEGER_LITERAL) {
+            type = TokenType::ERROR;
+        }
+    }
+    
+    // No token starts here: return a one-character error token
+    if (type == TokenType::ERROR) {
+        end = start + 1;
+    }
+    
+    Token token(type, inputBuffer.substr(start, end - start), inputOffset + start);
+    position = end;
+    return token;
+}
+
+// Lex the token at the current position, skipping whitespace and comments
+Token LexicalAnalyzer::lexNextToken() {
+    if (mode == LexerMode::TABLE) {
+        skipWhitespace();
+    } else {
+        skipWhitespaceAndComments();
+    }
+    if (position >= inputBuffer.length()) {
+        return Token(TokenType::END_OF_FILE, "", inputOffset + position);
+    }
+    
+    Token token = (mode == LexerMode::TABLE) ? scanToken() : findNextToken();
+    
+    // Identifiers are hashed and literals converted once, here; later
+    // stages use the id or the constant pool index
+    if (token.type == TokenType::IDENTIFIER) {
+        token.value = interner->intern(token.lexeme);
+    } else if (token.type == TokenType::INTEGER_LITERAL || token.type == TokenType::FLOAT_LITERAL) {
+        token.value = convertLiteral(token);
+    }
+    
+    // If error token, report it
+    if (token.type == TokenType::ERROR && errorHandler) {
+        errorHandler->lexicalError("Invalid token: '" + std::string(token.lexeme) + "'", token.offset);
+    }
+    return token;
+}
+
+// Convert a literal with std::from_chars. The lexeme is already known to
+// be digits (with one '.' for a float), so the only possible failure is a
+// value out of range: beyond int64_t, or a float that over- or underflows.
+uint32_t LexicalAnalyzer::convertLiteral(const Token& token) {
+    const char* first = token.lexeme.data();
+    const char* last = first + token.lexeme.length();
+    
+    if (token.type == TokenType::INTEGER_LITERAL) {
+        int64_t value = 0;
+        if (std::from_chars(first, last, value).ec == std::errc()) {
+            return constants->addInteger(value);
+        }
+    } else {
+        double value = 0;
+        if (std::from_chars(first, last, value, std::chars_format::fixed).ec == std::errc()) {
+            return constants->addFloat(value);
+        }
+    }
+    
+    if (errorHandler) {
+        errorHandler->lexicalError("Literal out of range: '" + std::string(token.lexeme) + "'", token.offset);
+    }
+    return ConstantPool::npos;
+}
+
 // Get the next token from the stream
 Token LexicalAnalyzer::getNextToken() {
-    static size_t currentPos = 0;
+    if (lazy) {
+        if (lookahead.empty()) {
+            return lexNextToken();
+        }
+        Token token = lookahead.front();
+        lookahead.pop_front();
+        return token;
+    }
     
-    if (currentPos < tokenStream.size()) {
-        return tokenStream[currentPos++];
+    if (readPosition < tokens.size()) {
+        return tokens.token(readPosition++);
     } else {
-        return Token(TokenType::END_OF_FILE, "", line, column);
+        return Token(TokenType::END_OF_FILE, "", inputOffset + position);
     }
 }
 
+// Continue reading at a token index
+void LexicalAnalyzer::seekToken(size_t index) {
+    readPosition = std::min(index, tokens.size());
+}
+
 // Peek at a future token
-Token LexicalAnalyzer::peekToken(int ahead) const {
-    static size_t currentPos = 0;
+Token LexicalAnalyzer::peekToken(int ahead) {
+    if (ahead < 1) ahead = 1;
+    
+    if (lazy) {
+        while (lookahead.size() < static_cast<size_t>(ahead)) {
+            lookahead.push_back(lexNextToken());
+        }
+        return lookahead[ahead - 1];
+    }
     
-    size_t index = currentPos + ahead - 1;
-    if (index < tokenStream.size()) {
-        return tokenStream[index];
+    size_t index = readPosition + ahead - 1;
+    if (index < tokens.size()) {
+        return tokens.token(index);
     } else {
-        return Token(TokenType::END_OF_FILE, "", line, column);
+        return Token(TokenType::END_OF_FILE, "", inputOffset + position);
+    }
+}
+
+// Set up parallel tokenization
+void LexicalAnalyzer::setThreadCount(unsigned count, size_t minBytes) {
+    threadCount = count > 0 ? count : 1;
+    parallelMinBytes = minBytes;
+}
+
+// Lex one newline-aligned chunk with a private scanner
+LexicalAnalyzer::ChunkResult LexicalAnalyzer::lexChunk(std::string_view chunk, bool startsInComment,
+                                                       bool isLast) const {
+    LexicalAnalyzer worker;
+    worker.inputBuffer = chunk;
+    worker.inputOffset = chunk.data() - inputBuffer.data();
+    worker.atInputEnd = isLast;
+    if (startsInComment) {
+        worker.openComment = OpenComment::BLOCK;
+        worker.openCommentOffset = std::string_view::npos;
+    }
+    
+    ChunkResult result;
+    while (true) {
+        Token token = worker.lexNextToken();
+        if (token.type == TokenType::END_OF_FILE) break;
+        result.tokens.push(token.type, static_cast<uint32_t>(token.offset),
+                           static_cast<uint32_t>(token.lexeme.length()), token.value);
+    }
+    
+    result.lines = *worker.lineIndex;
+    result.names = std::move(*worker.interner);
+    result.constants = std::move(*worker.constants);
+    result.endsInComment = worker.openComment == OpenComment::BLOCK || worker.commentRanToEnd;
+    result.commentOffset = worker.openCommentOffset;
+    return result;
+}
+
+// Lex the source on several threads
+void LexicalAnalyzer::tokenizeParallel() {
+    const char* data = inputBuffer.data();
+    const size_t length = inputBuffer.length();
+    
+    // Split into chunks that each start at the beginning of a line
+    std::vector<size_t> bounds = {0};
+    for (unsigned i = 1; i < threadCount; ++i) {
+        size_t target = std::max(bounds.back(), length * i / threadCount);
+        const char* newline = LexerSimd::findLineEnd(data + target, data + length);
+        if (newline >= data + length) break;
+        size_t bound = (newline - data) + 1;
+        if (bound > bounds.back()) bounds.push_back(bound);
+    }
+    bounds.push_back(length);
+    const size_t chunkCount = bounds.size() - 1;
+    
+    // Speculate both start states for every chunk but the first
+    std::vector<ChunkResult> outside(chunkCount), inside(chunkCount);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        workers.emplace_back([this, &outside, &inside, &bounds, i, chunkCount]() {
+            std::string_view chunk = inputBuffer.substr(bounds[i], bounds[i + 1] - bounds[i]);
+            bool isLast = (i + 1 == chunkCount);
+            outside[i] = lexChunk(chunk, false, isLast);
+            if (i > 0) inside[i] = lexChunk(chunk, true, isLast);
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    // Sequential fix-up: follow the real comment state from chunk to chunk
+    size_t total = 0;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        total += std::max(outside[i].tokens.size(), inside[i].tokens.size());
+    }
+    tokens.reserve(total + 1);
+    
+    bool hasLexicalErrors = false;
+    bool inComment = false;
+    size_t commentOffset = 0;
+    
+    for (size_t i = 0; i < chunkCount; ++i) {
+        const ChunkResult& result = inComment ? inside[i] : outside[i];
+        
+        // Offsets are already absolute; only the line starts need joining
+        lineIndex->append(result.lines);
+        
+        // Map chunk-local identifier ids to shared ones, once per distinct name
+        std::vector<uint32_t> ids(result.names.size());
+        for (uint32_t id = 0; id < ids.size(); ++id) {
+            ids[id] = interner->intern(result.names.name(id));
+        }
+        
+        // Likewise for constant pool indices
+        std::vector<uint32_t> constantIds(result.constants.size());
+        for (uint32_t id = 0; id < constantIds.size(); ++id) {
+            constantIds[id] = result.constants.isFloat(id) ? constants->addFloat(result.constants.floatValue(id))
+                                                           : constants->addInteger(result.constants.integerValue(id));
+        }
+        
+        for (size_t j = 0; j < result.tokens.size(); ++j) {
+            TokenType type = result.tokens.type(j);
+            uint32_t value = result.tokens.value(j);
+            bool isLiteral = type == TokenType::INTEGER_LITERAL || type == TokenType::FLOAT_LITERAL;
+            if (type == TokenType::IDENTIFIER) {
+                value = ids[value];
+            } else if (isLiteral && value != ConstantPool::npos) {
+                value = constantIds[value];
+            }
+            tokens.push(type, result.tokens.offset(j), result.tokens.length(j), value);
+            
+            // Workers have no error handler, so their errors are reported here, in order
+            if (type == TokenType::ERROR && errorHandler) {
+                size_t index = tokens.size() - 1;
+                errorHandler->lexicalError("Invalid token: '" + std::string(tokens.lexeme(index)) + "'",
+                                           tokens.offset(index));
+                hasLexicalErrors = true;
+            } else if (isLiteral && value == ConstantPool::npos && errorHandler) {
+                size_t index = tokens.size() - 1;
+                errorHandler->lexicalError("Literal out of range: '" + std::string(tokens.lexeme(index)) + "'",
+                                           tokens.offset(index));
+            }
+        }
+        
+        // A comment opened in this chunk remembers where it started
+        if (result.endsInComment && result.commentOffset != std::string_view::npos) {
+            commentOffset = result.commentOffset;
+        }
+        inComment = result.endsInComment;
     }
+    
+    // Workers have no error handler, so an unterminated comment is reported here
+    if (inComment && errorHandler) {
+        errorHandler->lexicalError("Unterminated comment", commentOffset);
+    }
+    
+    position = length;
+    tokens.push(TokenType::END_OF_FILE, static_cast<uint32_t>(length), 0, 0);
+    
+    if (hasLexicalErrors) {
+        std::cerr << "Lexical errors detected!" << std::endl;
+    }
+}
+
+// Enable or disable on-demand tokenization
+void LexicalAnalyzer::setLazy(bool enabled) {
+    lazy = enabled;
+}
+
+// Check for on-demand tokenization
+bool LexicalAnalyzer::isLazy() const {
+    return lazy;
 }
 
 // Get the token stream
-const std::vector<Token>& LexicalAnalyzer::getTokenStream() const {
-    return tokenStream;
+const TokenStore& LexicalAnalyzer::getTokens() const {
+    return tokens;
 }
 
 // Print the token stream
 void LexicalAnalyzer::printTokenStream() const {
     std::cout << "Token Stream:" << std::endl;
-    for (const auto& token : tokenStream) {
-        std::cout << token.toString() << std::endl;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        std::cout << tokens.token(i).toString(tokens.location(i)) << std::endl;
     }
 }
 
@@ -332,11 +992,8 @@ void LexicalAnalyzer::writeTokensToFile(const std::string& filename) const {
     
     file << "Token Type,Lexeme,Line,Column" << std::endl;
     
-    for (const auto& token : tokenStream) {
-        file << token.getTypeAsString() << ","
-             << "\"" << token.lexeme << "\","
-             << token.line << ","
-             << token.column << std::endl;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        writeTokenDetail(file, tokens.token(i), tokens.location(i));
     }
     
     file.close();
@@ -350,19 +1007,32 @@ void LexicalAnalyzer::writeTokenStreamToFile(const std::string& filename) const
         return;
     }
     
-    for (const auto& token : tokenStream) {
-        file << token.getTypeAsString();
-        if (token.type == TokenType::IDENTIFIER || 
-            token.type == TokenType::INTEGER_LITERAL || 
-            token.type == TokenType::FLOAT_LITERAL) {
-            file << " (" << token.lexeme << ")";
-        }
-        file << std::endl;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        writeTokenStreamEntry(file, tokens.token(i));
     }
     
     file.close();
 }
 
+// Write one line of the detailed token file
+void LexicalAnalyzer::writeTokenDetail(std::ostream& out, const Token& token, const SourceLocation& location) {
+    out << token.getTypeAsString() << ","
+        << "\"" << token.lexeme << "\","
+        << location.line << ","
+        << location.column << '\n';
+}
+
+// Write one line of the simplified token stream file
+void LexicalAnalyzer::writeTokenStreamEntry(std::ostream& out, const Token& token) {
+    out << token.getTypeAsString();
+    if (token.type == TokenType::IDENTIFIER || 
+        token.type == TokenType::INTEGER_LITERAL || 
+        token.type == TokenType::FLOAT_LITERAL) {
+        out << " (" << token.lexeme << ")";
+    }
+    out << '\n';
+}
+
 // Helper methods
 char LexicalAnalyzer::peek() const {
     if (isAtEnd()) return '\0';
@@ -372,7 +1042,6 @@ char LexicalAnalyzer::peek() const {
 char LexicalAnalyzer::advance() {
     char c = peek();
     position++;
-    column++;
     return c;
 }
 
@@ -386,55 +1055,91 @@ bool LexicalAnalyzer::match(char expected) {
     return true;
 }
 
-void LexicalAnalyzer::skipWhitespace() {
-    while (!isAtEnd()) {
-        char c = peek();
+bool LexicalAnalyzer::skipWhitespace() {
+    const char* begin = inputBuffer.data();
+    const char* end = begin + inputBuffer.length();
+    const char* p = begin + position;
+    bool complete = true;
+    
+    // The kernels record every newline they pass into the line index
+    LexerSimd::NewlineCount newlines;
+    lineIndex->attach(newlines, begin, inputOffset);
+    
+    // Where the body of an open block comment starts in this window
+    const char* blockBody = p;
+    
+    // Finish a comment left open by the previous streaming window
+    if (openComment == OpenComment::LINE) {
+        p = LexerSimd::findLineEnd(p, end);
+        if (p < end || atInputEnd) openComment = OpenComment::NONE;
+    } else if (openComment == OpenComment::BLOCK) {
+        p = LexerSimd::findBlockCommentEnd(p, end, newlines);
+        if (p < end) {
+            p += 2;
+            openComment = OpenComment::NONE;
+        }
+    }
+    
+    while (p < end && openComment == OpenComment::NONE) {
+        unsigned char cc = classOf(*p);
+        
+        if (cc == CC_SPACE || cc == CC_NEWLINE) {
+            p = LexerSimd::skipWhitespace(p, end, newlines);
+            continue;
+        }
         
-        if (c == ' ' || c == '\t' || c == '\r') {
-            advance();
-        } else if (c == '\n') {
-            advance();
-            line++;
-            column = 1;
-        } else if (c == '/') {
-            // Check for comments
-            if (position + 1 < inputBuffer.length() && inputBuffer[position + 1] == '/') {
-                // Single-line comment
-                position += 2;
-                column += 2;
-                
-                // Consume until end of line
-                while (!isAtEnd() && peek() != '\n') {
-                    advance();
-                }
-            } else if (position + 1 < inputBuffer.length() && inputBuffer[position + 1] == '*') {
-                // Multi-line comment
-                position += 2;
-                column += 2;
-                
-                bool endFound = false;
-                while (!isAtEnd() && !endFound) {
-                    if (peek() == '*' && position + 1 < inputBuffer.length() &&
-                        inputBuffer[position + 1] == '/') {
-                        // End of multi-line comment found
-                        position += 2;
-                        column += 2;
-                        endFound = true;
-                    } else if (peek() == '\n') {
-                        advance();
-                        line++;
-                        column = 1;
-                    } else {
-                        advance();
-                    }
-                }
+        // Anything other than a comment ends the gap
+        if (cc != CC_SLASH) break;
+        if (p + 1 >= end) {
+            // A '/' at the end of a window may still start a comment
+            complete = atInputEnd;
+            break;
+        }
+        
+        if (p[1] == '/') {
+            // Single-line comment: consume until end of line
+            p = LexerSimd::findLineEnd(p + 2, end);
+            if (p == end && !atInputEnd) openComment = OpenComment::LINE;
+        } else if (p[1] == '*') {
+            // Multi-line comment
+            openCommentOffset = inputOffset + (p - begin);
+            blockBody = p + 2;
+            
+            p = LexerSimd::findBlockCommentEnd(blockBody, end, newlines);
+            if (p < end) {
+                p += 2;
             } else {
-                // Not a comment, just a divide operator
-                break;
+                openComment = OpenComment::BLOCK;
             }
         } else {
-            // Not whitespace or comment
+            // Not a comment, just a divide operator
             break;
         }
     }
-}
\ No newline at end of file
+    
+    if (openComment == OpenComment::BLOCK) {
+        if (atInputEnd) {
+            openComment = OpenComment::NONE;
+            commentRanToEnd = true;
+            if (errorHandler) {
+                errorHandler->lexicalError("Unterminated comment", openCommentOffset);
+            }
+        } else if (p > blockBody && p[-1] == '*') {
+            // Keep a trailing '*' in case the next window starts with '/'
+            p--;
+        }
+    }
+    if (openComment != OpenComment::NONE) complete = false;
+    
+    position = p - begin;
+    return complete;
+}
+
+// Add the line starts inside a skipped stretch of the current input
+void LexicalAnalyzer::recordNewlines(std::string_view skipped) {
+    for (size_t i = 0; i < skipped.length(); ++i) {
+        if (skipped[i] == '\n') {
+            lineIndex->addLineStart(inputOffset + (skipped.data() - inputBuffer.data()) + i + 1);
+        }
+    }
+}
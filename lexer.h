@@ -1,17 +1,25 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include "source_location.h"
+#include "interner.h"
+#include "constant_pool.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <fstream>
 #include <map>
 #include <set>
 #include <regex>
 #include <memory>
+#include <functional>
+#include <deque>
+#include <cstdint>
 
 // Forward declarations
 class SymbolTable;
 class ErrorHandler;
+class SourceBuffer;
 
 // Token types
 enum class TokenType {
@@ -35,26 +43,98 @@ enum class TokenType {
 };
 
 // Token structure
+// The lexeme is a view into the SourceBuffer held by the lexer; copy it into
+// a std::string before storing it anywhere that outlives the lexer.
+// The position is a byte offset; LexicalAnalyzer::locate turns it into a
+// line and column.
 struct Token {
     TokenType type;
-    std::string lexeme;
-    int line;
-    int column;
+    uint32_t value;             // Interned name id of an IDENTIFIER, constant
+                                // pool index of a literal
+    std::string_view lexeme;
+    size_t offset;
     
     // Constructor
-    Token(TokenType t, const std::string& l, int ln, int col)
-        : type(t), lexeme(l), line(ln), column(col) {}
+    Token(TokenType t, std::string_view l, size_t off, uint32_t v = 0)
+        : type(t), value(v), lexeme(l), offset(off) {}
     
     // Default constructor
-    Token() : type(TokenType::ERROR), lexeme(""), line(0), column(0) {}
+    Token() : type(TokenType::ERROR), value(0), lexeme(""), offset(0) {}
     
     // For debugging
-    std::string toString() const;
+    std::string toString(const SourceLocation& location) const;
     
     // Get token type as string
     std::string getTypeAsString() const;
 };
 
+// Token stream stored as parallel arrays: a one-byte type plus a 32-bit
+// source offset, length and value per token (13 bytes, against 32 for a Token).
+// Line and column are resolved through the lexer's LineIndex when asked for.
+class TokenStore {
+private:
+    std::string_view text;              // Source the offsets refer to
+    const LineIndex* lines = nullptr;   // Line starts of that source
+    std::vector<uint8_t> types;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint32_t> values;
+    
+public:
+    // Set the text the offsets refer to and its line index
+    void setSource(std::string_view source, const LineIndex* lineIndex);
+    
+    // Remove all tokens
+    void clear();
+    
+    // Reserve space for a number of tokens
+    void reserve(size_t count);
+    
+    // Append a token
+    void push(TokenType type, uint32_t offset, uint32_t length, uint32_t value);
+    
+    // Replace tokens [first, last) with another store's tokens and add
+    // shift to the offsets of the tokens after them
+    void splice(size_t first, size_t last, const TokenStore& replacement, int64_t shift);
+    
+    // Number of tokens
+    size_t size() const { return types.size(); }
+    bool empty() const { return types.empty(); }
+    
+    // Per-token fields
+    TokenType type(size_t index) const { return static_cast<TokenType>(types[index]); }
+    uint32_t offset(size_t index) const { return offsets[index]; }
+    uint32_t length(size_t index) const { return lengths[index]; }
+    uint32_t value(size_t index) const { return values[index]; }
+    std::string_view lexeme(size_t index) const { return text.substr(offsets[index], lengths[index]); }
+    
+    // Line and column of a token
+    SourceLocation location(size_t index) const;
+    
+    // Build a Token for one entry
+    Token token(size_t index) const;
+    
+    // Dense array of token types, for loops that only dispatch on type
+    const std::vector<uint8_t>& typeArray() const { return types; }
+    
+    // Bytes held by the token arrays (excluding the line-start cache)
+    size_t memoryUsage() const;
+};
+
+// Tokens changed by the last LexicalAnalyzer::applyEdit: `removed` old
+// tokens starting at index `first` were replaced by `inserted` new ones
+struct TokenEdit {
+    size_t first = 0;
+    size_t removed = 0;
+    size_t inserted = 0;
+};
+
+// Scanning strategy used by the lexical analyzer
+enum class LexerMode {
+    REGEX,  // Original std::regex matcher, kept as a reference implementation
+    TABLE   // Single-pass scanner driven by a character-class table
+};
+
 // Pattern structure for regex-based lexical analysis
 struct TokenPattern {
     std::regex pattern;
@@ -68,15 +148,73 @@ struct TokenPattern {
 // Lexical Analyzer
 class LexicalAnalyzer {
 private:
-    std::string inputBuffer;
+    std::shared_ptr<SourceBuffer> source;
+    std::string_view inputBuffer;   // View of the current source
     size_t position;
-    int line;
-    int column;
-    std::vector<Token> tokenStream;
+    size_t inputOffset;             // Offset of inputBuffer[0] in the whole input
+    std::shared_ptr<LineIndex> lineIndex;
+    TokenStore tokens;
+    
+    // Active scanning strategy
+    LexerMode mode;
+    
+    // Streaming state: false while more input may follow the current window
+    bool atInputEnd;
+    
+    // Comment left open at the end of a streaming window
+    enum class OpenComment { NONE, LINE, BLOCK };
+    OpenComment openComment;
+    size_t openCommentOffset;   // Where the open block comment starts
+    bool commentRanToEnd;   // The input ended inside a block comment
+    
+    // Set by scanToken when a match ran into the end of a non-final window
+    bool tokenMayContinue;
+    
+    // Set by scanToken: one past the last byte the scan looked at, or
+    // length + 1 if it ran into the end of the input
+    size_t scanExtent;
+    
+    // On-demand mode: tokens are lexed as the parser asks for them and only
+    // the lookahead buffer is kept
+    bool lazy;
+    std::deque<Token> lookahead;
+    
+    // Index of the next token handed out by getNextToken
+    size_t readPosition;
+    
+    // Token range changed by the last applyEdit
+    TokenEdit lastEdit;
+    
+    // Parallel tokenization settings
+    unsigned threadCount;
+    size_t parallelMinBytes;
+    
+    // Tokens of one newline-aligned chunk, lexed from a given start state
+    struct ChunkResult {
+        TokenStore tokens;             // Offsets are into the whole source
+        LineIndex lines;               // Line starts inside the chunk
+        Interner names;                // Identifiers, with ids local to the chunk
+        ConstantPool constants;        // Literals, with indices local to the chunk
+        bool endsInComment = false;    // A block comment is still open at the end
+        size_t commentOffset = 0;      // Start of that comment, or npos if it
+                                       // was already open at the chunk start
+    };
+    
+    // Lex one chunk on the calling thread
+    ChunkResult lexChunk(std::string_view chunk, bool startsInComment, bool isLast) const;
+    
+    // Lex the whole source across worker threads
+    void tokenizeParallel();
     
     // Keywords map
     static std::map<std::string, TokenType> keywords;
     
+    // Identifier ids of IDENTIFIER tokens (shared with the symbol table)
+    std::shared_ptr<Interner> interner;
+    
+    // Values of INTEGER_LITERAL and FLOAT_LITERAL tokens
+    std::shared_ptr<ConstantPool> constants;
+    
     // Reference to symbol table and error handler
     std::shared_ptr<SymbolTable> symbolTable;
     std::shared_ptr<ErrorHandler> errorHandler;
@@ -95,43 +233,121 @@ private:
     char advance();
     bool isAtEnd() const;
     bool match(char expected);
-    void skipWhitespace();
+    bool skipWhitespace();  // False if the window ended before the next token
     
     // Skip whitespace and comments
     void skipWhitespaceAndComments();
     
+    // Record the line starts inside a skipped part of inputBuffer
+    void recordNewlines(std::string_view skipped);
+    
     // Find the next token match
     Token findNextToken();
     
+    // Skip to and lex the next token (END_OF_FILE at the end of input)
+    Token lexNextToken();
+    
+    // Scan the next token using the character-class table
+    Token scanToken();
+    
     // Check if a token is at the current position
     std::pair<bool, Token> matchTokenAtPosition();
     
-    // Update position and line/column tracking
-    void updatePosition(size_t length);
+    // Reset scanning state for new input
+    void resetScanner();
+    
+    // Convert a literal token and add it to the constant pool. Returns
+    // ConstantPool::npos, after reporting it, if the value is out of range.
+    uint32_t convertLiteral(const Token& token);
+    
+    // Append a token lexed from inputBuffer to the store
+    void storeToken(const Token& token);
     
 public:
     // Constructor
     LexicalAnalyzer(std::shared_ptr<SymbolTable> symTable = nullptr, 
                    std::shared_ptr<ErrorHandler> errHandler = nullptr);
     
-    // Set communication channels
+    // Set communication channels. Both are given the lexer's line index so
+    // they can resolve token offsets when they report, and identifiers are
+    // interned into the symbol table's interner.
     void setSymbolTable(std::shared_ptr<SymbolTable> symTable);
     void setErrorHandler(std::shared_ptr<ErrorHandler> errHandler);
     
+    // Select the scanning strategy (defaults to LexerMode::TABLE)
+    void setMode(LexerMode m);
+    LexerMode getMode() const;
+    
     // Tokenize a file
     void tokenizeFile(const std::string& filename);
     
     // Tokenize a string
     void tokenizeString(const std::string& input);
     
+    // Tokenize a file through a fixed-size window, without keeping the file
+    // or the tokens in memory. Each token is passed to onToken; its lexeme is
+    // only valid during the call. The window grows only if a single token is
+    // longer than it. Returns false if the file cannot be opened.
+    bool tokenizeStream(const std::string& filename,
+                        const std::function<void(const Token&)>& onToken,
+                        size_t windowSize = 1 << 20);
+    
+    // Tokenize a source buffer (token lexemes will point into it)
+    void tokenizeSource(std::shared_ptr<SourceBuffer> src);
+    
+    // Access the source the current tokens point into
+    std::shared_ptr<SourceBuffer> getSource() const;
+    
+    // Edit the source: replace removedLength bytes at offset with
+    // insertedText, then re-lex from the last token the edit cannot affect
+    // until the new tokens line up with the old stream again. Tokens after
+    // that point are kept and only have their offsets shifted. The source
+    // buffer is modified in place, so lexemes of Tokens obtained earlier are
+    // invalidated. Not available in lazy mode; returns false if the edit is
+    // out of range.
+    bool applyEdit(size_t offset, size_t removedLength, std::string_view insertedText);
+    
+    // Token range changed by the last successful applyEdit
+    const TokenEdit& getLastEdit() const;
+    
+    // Line starts seen so far (during streaming, only those of the window)
+    std::shared_ptr<const LineIndex> getLineIndex() const;
+    
+    // Line and column of a token offset
+    SourceLocation locate(size_t offset) const;
+    
+    // Interner holding the names of IDENTIFIER token values
+    std::shared_ptr<Interner> getInterner() const;
+    
+    // Constant pool holding the values of literal tokens. Literals are
+    // converted once, while lexing; a literal whose value is out of range
+    // has the value ConstantPool::npos.
+    std::shared_ptr<ConstantPool> getConstantPool() const;
+    
     // Access the token stream
-    const std::vector<Token>& getTokenStream() const;
+    const TokenStore& getTokens() const;
     
     // Get the next token
     Token getNextToken();
     
+    // Make getNextToken continue at a token index (not in lazy mode)
+    void seekToken(size_t index);
+    
     // Peek at a token without consuming it
-    Token peekToken(int ahead = 1) const;
+    Token peekToken(int ahead = 1);
+    
+    // On-demand tokenization: tokenizeFile/tokenizeSource only load the
+    // source, and getNextToken lexes one token at a time. Nothing behind
+    // the parser is retained, so getTokens() stays empty.
+    void setLazy(bool enabled);
+    bool isLazy() const;
+    
+    // Lex inputs of at least minBytes on this many threads (table mode only).
+    // The buffer is split at newlines; each chunk is lexed both as if it
+    // started outside and inside a block comment, and a sequential pass
+    // picks the right result and fixes line numbers. The token stream and
+    // errors are identical to a single-threaded run.
+    void setThreadCount(unsigned count, size_t minBytes = 1 << 20);
     
     // Print the token stream
     void printTokenStream() const;
@@ -139,6 +355,10 @@ public:
     // Write tokens to files
     void writeTokensToFile(const std::string& filename) const;
     void writeTokenStreamToFile(const std::string& filename) const;
+    
+    // Write a single token in the format of tokens.txt / token_stream.txt
+    static void writeTokenDetail(std::ostream& out, const Token& token, const SourceLocation& location);
+    static void writeTokenStreamEntry(std::ostream& out, const Token& token);
 };
 
 #endif // LEXER_H
\ No newline at end of file
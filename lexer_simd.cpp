@@ -0,0 +1,334 @@
+#include "lexer_simd.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LEXER_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace LexerSimd {
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Scalar kernels (also used for the tails of the vector kernels)
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+// Record one newline at p
+inline void countNewline(const char* p, NewlineCount& newlines) {
+    newlines.count++;
+    newlines.last = p;
+    if (newlines.lineStarts) {
+        newlines.lineStarts->push_back(newlines.bias + static_cast<uint32_t>(p + 1 - newlines.origin));
+    }
+}
+
+const char* skipWhitespaceScalar(const char* p, const char* end, NewlineCount& newlines) {
+    while (p < end && isSpace(*p)) {
+        if (*p == '\n') countNewline(p, newlines);
+        p++;
+    }
+    return p;
+}
+
+const char* findLineEndScalar(const char* p, const char* end) {
+    while (p < end && *p != '\n') p++;
+    return p;
+}
+
+const char* findBlockCommentEndScalar(const char* p, const char* end, NewlineCount& newlines) {
+    while (p < end) {
+        if (*p == '*' && p + 1 < end && p[1] == '/') return p;
+        if (*p == '\n') countNewline(p, newlines);
+        p++;
+    }
+    return end;
+}
+
+const char* skipIdentifierCharsScalar(const char* p, const char* end) {
+    while (p < end && isIdentifierChar(*p)) p++;
+    return p;
+}
+
+// Record the newlines whose bits are set in mask, for a block starting at base
+inline void countNewlines(unsigned mask, const char* base, NewlineCount& newlines) {
+    if (mask) {
+        newlines.count += __builtin_popcount(mask);
+        newlines.last = base + (31 - __builtin_clz(mask));
+        if (newlines.lineStarts) {
+            uint32_t blockStart = newlines.bias + static_cast<uint32_t>(base + 1 - newlines.origin);
+            for (; mask; mask &= mask - 1) {
+                newlines.lineStarts->push_back(blockStart + __builtin_ctz(mask));
+            }
+        }
+    }
+}
+
+#ifdef LEXER_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// SSE2 kernels: 16 bytes per step
+
+inline __m128i inRange16(__m128i v, char lo, char hi) {
+    __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(static_cast<char>(hi - lo))), shifted);
+}
+
+const char* skipWhitespaceSse2(const char* p, const char* end, NewlineCount& newlines) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i nl = _mm_cmpeq_epi8(v, lf);
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, cr), nl));
+        unsigned nlMask = static_cast<unsigned>(_mm_movemask_epi8(nl));
+        unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(ws)) & 0xFFFFu;
+
+        if (stop) {
+            unsigned index = __builtin_ctz(stop);
+            countNewlines(nlMask & ((1u << index) - 1), p, newlines);
+            return p + index;
+        }
+        countNewlines(nlMask, p, newlines);
+        p += 16;
+    }
+    return skipWhitespaceScalar(p, end, newlines);
+}
+
+const char* findLineEndSse2(const char* p, const char* end) {
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf)));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return findLineEndScalar(p, end);
+}
+
+const char* findBlockCommentEndSse2(const char* p, const char* end, NewlineCount& newlines) {
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i slash = _mm_set1_epi8('/');
+    const __m128i lf = _mm_set1_epi8('\n');
+
+    // Each step also reads the byte after the block to see a '/' following a final '*'
+    while (end - p >= 17) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        unsigned close = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(v, star), _mm_cmpeq_epi8(next, slash))));
+        unsigned nlMask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, lf)));
+
+        if (close) {
+            unsigned index = __builtin_ctz(close);
+            countNewlines(nlMask & ((1u << index) - 1), p, newlines);
+            return p + index;
+        }
+        countNewlines(nlMask, p, newlines);
+        p += 16;
+    }
+    return findBlockCommentEndScalar(p, end, newlines);
+}
+
+const char* skipIdentifierCharsSse2(const char* p, const char* end) {
+    const __m128i lowerBit = _mm_set1_epi8(0x20);
+    const __m128i underscore = _mm_set1_epi8('_');
+
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i word = _mm_or_si128(
+            _mm_or_si128(inRange16(_mm_or_si128(v, lowerBit), 'a', 'z'), inRange16(v, '0', '9')),
+            _mm_cmpeq_epi8(v, underscore));
+        unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(word)) & 0xFFFFu;
+        if (stop) return p + __builtin_ctz(stop);
+        p += 16;
+    }
+    return skipIdentifierCharsScalar(p, end);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2 kernels: 32 bytes per step
+
+__attribute__((target("avx2")))
+inline __m256i inRange32(__m256i v, char lo, char hi) {
+    __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(static_cast<char>(hi - lo))), shifted);
+}
+
+// Bits below index, for a 32-bit block mask
+inline unsigned lowBits(unsigned index) {
+    return index >= 32 ? ~0u : (1u << index) - 1;
+}
+
+__attribute__((target("avx2")))
+const char* skipWhitespaceAvx2(const char* p, const char* end, NewlineCount& newlines) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i nl = _mm256_cmpeq_epi8(v, lf);
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), nl));
+        unsigned nlMask = static_cast<unsigned>(_mm256_movemask_epi8(nl));
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+
+        if (stop) {
+            unsigned index = __builtin_ctz(stop);
+            countNewlines(nlMask & lowBits(index), p, newlines);
+            return p + index;
+        }
+        countNewlines(nlMask, p, newlines);
+        p += 32;
+    }
+    return skipWhitespaceSse2(p, end, newlines);
+}
+
+__attribute__((target("avx2")))
+const char* findLineEndAvx2(const char* p, const char* end) {
+    const __m256i lf = _mm256_set1_epi8('\n');
+
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lf)));
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return findLineEndSse2(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* findBlockCommentEndAvx2(const char* p, const char* end, NewlineCount& newlines) {
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i slash = _mm256_set1_epi8('/');
+    const __m256i lf = _mm256_set1_epi8('\n');
+
+    while (end - p >= 33) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        unsigned close = static_cast<unsigned>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(v, star), _mm256_cmpeq_epi8(next, slash))));
+        unsigned nlMask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, lf)));
+
+        if (close) {
+            unsigned index = __builtin_ctz(close);
+            countNewlines(nlMask & lowBits(index), p, newlines);
+            return p + index;
+        }
+        countNewlines(nlMask, p, newlines);
+        p += 32;
+    }
+    return findBlockCommentEndSse2(p, end, newlines);
+}
+
+__attribute__((target("avx2")))
+const char* skipIdentifierCharsAvx2(const char* p, const char* end) {
+    const __m256i lowerBit = _mm256_set1_epi8(0x20);
+    const __m256i underscore = _mm256_set1_epi8('_');
+
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i word = _mm256_or_si256(
+            _mm256_or_si256(inRange32(_mm256_or_si256(v, lowerBit), 'a', 'z'), inRange32(v, '0', '9')),
+            _mm256_cmpeq_epi8(v, underscore));
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(word));
+        if (stop) return p + __builtin_ctz(stop);
+        p += 32;
+    }
+    return skipIdentifierCharsSse2(p, end);
+}
+
+#endif // LEXER_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// Dispatch
+
+struct Kernels {
+    Level level;
+    const char* (*skipWhitespace)(const char*, const char*, NewlineCount&);
+    const char* (*findLineEnd)(const char*, const char*);
+    const char* (*findBlockCommentEnd)(const char*, const char*, NewlineCount&);
+    const char* (*skipIdentifierChars)(const char*, const char*);
+};
+
+Kernels kernelsFor(Level level) {
+    switch (level) {
+#ifdef LEXER_SIMD_X86
+        case Level::AVX2:
+            return {Level::AVX2, skipWhitespaceAvx2, findLineEndAvx2,
+                    findBlockCommentEndAvx2, skipIdentifierCharsAvx2};
+        case Level::SSE2:
+            return {Level::SSE2, skipWhitespaceSse2, findLineEndSse2,
+                    findBlockCommentEndSse2, skipIdentifierCharsSse2};
+#endif
+        default:
+            return {Level::SCALAR, skipWhitespaceScalar, findLineEndScalar,
+                    findBlockCommentEndScalar, skipIdentifierCharsScalar};
+    }
+}
+
+Kernels& active() {
+    static Kernels kernels = kernelsFor(detectLevel());
+    return kernels;
+}
+
+} // namespace
+
+Level detectLevel() {
+#ifdef LEXER_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return Level::AVX2;
+    if (__builtin_cpu_supports("sse2")) return Level::SSE2;
+#endif
+    return Level::SCALAR;
+}
+
+Level activeLevel() {
+    return active().level;
+}
+
+void setLevel(Level level) {
+    Level best = detectLevel();
+    if (static_cast<int>(level) > static_cast<int>(best)) level = best;
+    active() = kernelsFor(level);
+}
+
+const char* levelName(Level level) {
+    switch (level) {
+        case Level::AVX2: return "AVX2";
+        case Level::SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
+
+const char* skipWhitespace(const char* p, const char* end, NewlineCount& newlines) {
+    return active().skipWhitespace(p, end, newlines);
+}
+
+const char* findLineEnd(const char* p, const char* end) {
+    return active().findLineEnd(p, end);
+}
+
+const char* findBlockCommentEnd(const char* p, const char* end, NewlineCount& newlines) {
+    return active().findBlockCommentEnd(p, end, newlines);
+}
+
+const char* skipIdentifierChars(const char* p, const char* end) {
+    return active().skipIdentifierChars(p, end);
+}
+
+} // namespace LexerSimd
@@ -0,0 +1,59 @@
+#ifndef LEXER_SIMD_H
+#define LEXER_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Block-at-a-time scanning kernels for the lexer's hot loops.
+// Each kernel has SSE2 and AVX2 versions on x86 plus a portable scalar
+// fallback; the best supported version is picked at startup via CPUID.
+namespace LexerSimd {
+
+// Instruction set used by the kernels
+enum class Level {
+    SCALAR,
+    SSE2,
+    AVX2
+};
+
+// Newlines passed over by a kernel, for line/column tracking
+struct NewlineCount {
+    size_t count = 0;             // Number of '\n' bytes seen
+    const char* last = nullptr;   // Position of the last '\n' seen
+    
+    // If set, the start of each new line is appended here as
+    // bias + (offset of the byte after the '\n' from origin)
+    std::vector<uint32_t>* lineStarts = nullptr;
+    const char* origin = nullptr;
+    uint32_t bias = 0;
+};
+
+// Best level supported by this CPU
+Level detectLevel();
+
+// Level currently in use
+Level activeLevel();
+
+// Force a level (clamped to what the CPU supports), e.g. for benchmarking
+void setLevel(Level level);
+
+// Name of a level for reports
+const char* levelName(Level level);
+
+// Return the first byte in [p, end) that is not ' ', '\t', '\r' or '\n'
+const char* skipWhitespace(const char* p, const char* end, NewlineCount& newlines);
+
+// Return the first '\n' in [p, end), or end
+const char* findLineEnd(const char* p, const char* end);
+
+// Return the start of the first "*/" in [p, end), or end if there is none.
+// Newlines before the returned position are counted.
+const char* findBlockCommentEnd(const char* p, const char* end, NewlineCount& newlines);
+
+// Return the first byte in [p, end) that is not in [a-zA-Z0-9_]
+const char* skipIdentifierChars(const char* p, const char* end);
+
+} // namespace LexerSimd
+
+#endif // LEXER_SIMD_H
@@ -0,0 +1,26 @@
+#ifndef LEXER_TABLES_H
+#define LEXER_TABLES_H
+
+#include "lexer.h"
+
+// DFA for token recognition, generated by lexgen from grammar.txt
+// (see the lexer_tables.cpp target in the Makefile).
+namespace LexerTables {
+    // State 0 is the dead state: no token can be extended from it
+    const unsigned char deadState = 0;
+    
+    extern const int numStates;
+    extern const unsigned char startState;
+    
+    // Identifier state that loops on [a-zA-Z0-9_] and can no longer become
+    // a keyword (deadState if the token set has none)
+    extern const unsigned char identifierRunState;
+    
+    // Token accepted in each state, TokenType::ERROR if not accepting
+    extern const TokenType acceptType[];
+    
+    // Next state for every (state, input byte) pair
+    extern const unsigned char transitions[][256];
+}
+
+#endif // LEXER_TABLES_H
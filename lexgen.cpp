@@ -0,0 +1,467 @@
+// Lexer table generator
+//
+// Reads the terminal definitions (ID, intConst, floatConst) from grammar.txt,
+// combines them with the keyword and operator set, and writes a minimized DFA
+// as C++ transition tables. The generated file implements lexer_tables.h.
+//
+// Usage: lexgen <grammar.txt> <output.cpp>
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// A token rule: either a regex read from the grammar or a literal spelling.
+// Rules listed first win when two rules accept the same longest match.
+struct TokenRule {
+    std::string tokenType;   // TokenType enumerator name
+    std::string pattern;     // Regex text or literal spelling
+    bool isLiteral;
+};
+
+// Keywords, operators and punctuation, in priority order
+static const std::vector<std::pair<std::string, std::string>> literalTokens = {
+    {"int", "INT"}, {"float", "FLOAT"}, {"while", "WHILE"}, {"main", "MAIN"},
+    {"++", "INCREMENT"}, {"--", "DECREMENT"},
+    {"+", "PLUS"}, {"-", "MINUS"}, {"*", "MULTIPLY"}, {"/", "DIVIDE"},
+    {"=", "ASSIGN"}, {"<", "LESS_THAN"}, {">", "GREATER_THAN"},
+    {";", "SEMICOLON"}, {",", "COMMA"}, {"(", "LEFT_PAREN"}, {")", "RIGHT_PAREN"},
+    {"{", "LEFT_BRACE"}, {"}", "RIGHT_BRACE"}
+};
+
+// Grammar terminals defined by regex, and the TokenType each one produces
+static const std::vector<std::pair<std::string, std::string>> regexTerminals = {
+    {"floatConst", "FLOAT_LITERAL"},
+    {"intConst", "INTEGER_LITERAL"},
+    {"ID", "IDENTIFIER"}
+};
+
+// ---------------------------------------------------------------------------
+// NFA construction (Thompson)
+
+typedef std::bitset<256> ByteSet;
+
+struct NfaState {
+    std::vector<std::pair<ByteSet, int>> edges;
+    std::vector<int> epsilon;
+    int acceptRule = -1;
+};
+
+struct NfaFragment {
+    int start;
+    int end;
+};
+
+class NfaBuilder {
+private:
+    std::vector<NfaState>& states;
+    const std::string& text;
+    size_t pos;
+
+    int newState() {
+        states.emplace_back();
+        return static_cast<int>(states.size()) - 1;
+    }
+
+    NfaFragment byteSet(const ByteSet& set) {
+        NfaFragment f{newState(), newState()};
+        states[f.start].edges.push_back({set, f.end});
+        return f;
+    }
+
+    char escaped(char c) const {
+        switch (c) {
+            case 'n': return '\n';
+            case 't': return '\t';
+            case 'r': return '\r';
+            default: return c;
+        }
+    }
+
+    ByteSet parseClass() {
+        // Called with pos just past '['
+        ByteSet set;
+        bool negate = false;
+        if (pos < text.size() && text[pos] == '^') {
+            negate = true;
+            pos++;
+        }
+
+        while (pos < text.size() && text[pos] != ']') {
+            char lo = text[pos++];
+            if (lo == '\\' && pos < text.size()) lo = escaped(text[pos++]);
+
+            char hi = lo;
+            if (pos + 1 < text.size() && text[pos] == '-' && text[pos + 1] != ']') {
+                pos++;
+                hi = text[pos++];
+                if (hi == '\\' && pos < text.size()) hi = escaped(text[pos++]);
+            }
+
+            for (int c = static_cast<unsigned char>(lo); c <= static_cast<unsigned char>(hi); ++c) {
+                set.set(c);
+            }
+        }
+
+        if (pos >= text.size()) throw std::runtime_error("Unterminated character class in '" + text + "'");
+        pos++;  // Skip ']'
+
+        if (negate) set.flip();
+        return set;
+    }
+
+    NfaFragment parseAtom() {
+        char c = text[pos++];
+        if (c == '(') {
+            NfaFragment inner = parseAlternation();
+            if (pos >= text.size() || text[pos] != ')') {
+                throw std::runtime_error("Missing ')' in '" + text + "'");
+            }
+            pos++;
+            return inner;
+        }
+
+        ByteSet set;
+        if (c == '[') {
+            set = parseClass();
+        } else if (c == '\\' && pos < text.size()) {
+            set.set(static_cast<unsigned char>(escaped(text[pos++])));
+        } else if (c == '.') {
+            set.set();
+            set.reset('\n');
+        } else {
+            set.set(static_cast<unsigned char>(c));
+        }
+        return byteSet(set);
+    }
+
+    NfaFragment parseRepetition() {
+        NfaFragment f = parseAtom();
+
+        while (pos < text.size() && (text[pos] == '*' || text[pos] == '+' || text[pos] == '?')) {
+            char op = text[pos++];
+            NfaFragment r{newState(), newState()};
+            states[r.start].epsilon.push_back(f.start);
+            states[f.end].epsilon.push_back(r.end);
+            if (op != '+') states[r.start].epsilon.push_back(r.end);
+            if (op != '?') states[f.end].epsilon.push_back(f.start);
+            f = r;
+        }
+        return f;
+    }
+
+    NfaFragment parseConcatenation() {
+        NfaFragment f{newState(), -1};
+        f.end = f.start;
+
+        while (pos < text.size() && text[pos] != '|' && text[pos] != ')') {
+            NfaFragment next = parseRepetition();
+            states[f.end].epsilon.push_back(next.start);
+            f.end = next.end;
+        }
+        return f;
+    }
+
+    NfaFragment parseAlternation() {
+        NfaFragment first = parseConcatenation();
+        if (pos >= text.size() || text[pos] != '|') return first;
+
+        NfaFragment f{newState(), newState()};
+        states[f.start].epsilon.push_back(first.start);
+        states[first.end].epsilon.push_back(f.end);
+
+        while (pos < text.size() && text[pos] == '|') {
+            pos++;
+            NfaFragment alt = parseConcatenation();
+            states[f.start].epsilon.push_back(alt.start);
+            states[alt.end].epsilon.push_back(f.end);
+        }
+        return f;
+    }
+
+public:
+    NfaBuilder(std::vector<NfaState>& s, const std::string& t) : states(s), text(t), pos(0) {}
+
+    NfaFragment buildRegex() {
+        NfaFragment f = parseAlternation();
+        if (pos != text.size()) throw std::runtime_error("Unexpected ')' in '" + text + "'");
+        return f;
+    }
+
+    NfaFragment buildLiteral() {
+        NfaFragment f{newState(), -1};
+        f.end = f.start;
+        for (char c : text) {
+            ByteSet set;
+            set.set(static_cast<unsigned char>(c));
+            NfaFragment next = byteSet(set);
+            states[f.end].epsilon.push_back(next.start);
+            f.end = next.end;
+        }
+        return f;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Subset construction and minimization
+
+struct Dfa {
+    std::vector<std::vector<int>> transitions;  // [state][byte] -> state
+    std::vector<int> acceptRule;                // -1 if not accepting
+    int start;                                  // State 0 is always the dead state
+};
+
+static void epsilonClosure(const std::vector<NfaState>& nfa, std::vector<int>& set) {
+    std::vector<int> work(set.begin(), set.end());
+    std::set<int> seen(set.begin(), set.end());
+    while (!work.empty()) {
+        int s = work.back();
+        work.pop_back();
+        for (int t : nfa[s].epsilon) {
+            if (seen.insert(t).second) work.push_back(t);
+        }
+    }
+    set.assign(seen.begin(), seen.end());
+}
+
+static Dfa buildDfa(const std::vector<NfaState>& nfa, int nfaStart) {
+    Dfa dfa;
+    std::map<std::vector<int>, int> ids;
+    std::vector<std::vector<int>> sets;
+
+    auto addState = [&](const std::vector<int>& set) {
+        auto it = ids.find(set);
+        if (it != ids.end()) return it->second;
+
+        int id = static_cast<int>(sets.size());
+        ids[set] = id;
+        sets.push_back(set);
+
+        int accept = -1;
+        for (int s : set) {
+            if (nfa[s].acceptRule >= 0 && (accept < 0 || nfa[s].acceptRule < accept)) {
+                accept = nfa[s].acceptRule;
+            }
+        }
+        dfa.acceptRule.push_back(accept);
+        dfa.transitions.emplace_back(256, 0);
+        return id;
+    };
+
+    addState({});  // Dead state
+    std::vector<int> startSet = {nfaStart};
+    epsilonClosure(nfa, startSet);
+    dfa.start = addState(startSet);
+
+    for (size_t current = 1; current < sets.size(); ++current) {
+        const std::vector<int> currentSet = sets[current];
+        for (int byte = 0; byte < 256; ++byte) {
+            std::vector<int> next;
+            for (int s : currentSet) {
+                for (const auto& edge : nfa[s].edges) {
+                    if (edge.first.test(byte)) next.push_back(edge.second);
+                }
+            }
+            if (next.empty()) continue;
+
+            epsilonClosure(nfa, next);
+            int target = addState(next);
+            dfa.transitions[current][byte] = target;
+        }
+    }
+
+    return dfa;
+}
+
+// Moore-style partition refinement. States are equivalent when they accept
+// the same rule and move to equivalent states on every byte.
+static Dfa minimizeDfa(const Dfa& dfa) {
+    const size_t n = dfa.transitions.size();
+    std::vector<int> block(n);
+
+    // Initial partition by accepted rule; the dead state gets its own block
+    std::map<int, int> byRule;
+    for (size_t s = 0; s < n; ++s) {
+        int key = (s == 0) ? -2 : dfa.acceptRule[s];
+        auto it = byRule.find(key);
+        if (it == byRule.end()) it = byRule.emplace(key, static_cast<int>(byRule.size())).first;
+        block[s] = it->second;
+    }
+
+    size_t blockCount = byRule.size();
+    while (true) {
+        std::map<std::vector<int>, int> signatures;
+        std::vector<int> nextBlock(n);
+
+        for (size_t s = 0; s < n; ++s) {
+            std::vector<int> signature;
+            signature.reserve(257);
+            signature.push_back(block[s]);
+            for (int byte = 0; byte < 256; ++byte) {
+                signature.push_back(block[dfa.transitions[s][byte]]);
+            }
+            auto it = signatures.find(signature);
+            if (it == signatures.end()) {
+                it = signatures.emplace(signature, static_cast<int>(signatures.size())).first;
+            }
+            nextBlock[s] = it->second;
+        }
+
+        block.swap(nextBlock);
+        if (signatures.size() == blockCount) break;
+        blockCount = signatures.size();
+    }
+
+    // Renumber so the dead state stays 0 and states appear in discovery order
+    std::vector<int> renumber(blockCount, -1);
+    int nextId = 0;
+    renumber[block[0]] = nextId++;
+    for (size_t s = 1; s < n; ++s) {
+        if (renumber[block[s]] < 0) renumber[block[s]] = nextId++;
+    }
+
+    Dfa result;
+    result.transitions.assign(blockCount, std::vector<int>(256, 0));
+    result.acceptRule.assign(blockCount, -1);
+    result.start = renumber[block[dfa.start]];
+    for (size_t s = 0; s < n; ++s) {
+        int id = renumber[block[s]];
+        result.acceptRule[id] = dfa.acceptRule[s];
+        for (int byte = 0; byte < 256; ++byte) {
+            result.transitions[id][byte] = renumber[block[dfa.transitions[s][byte]]];
+        }
+    }
+    return result;
+}
+
+// ---------------------------------------------------------------------------
+// Grammar reading and output
+
+static std::string trim(const std::string& s) {
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return "";
+    size_t last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+// Read "NAME → definition" rules, keyed by name
+static std::map<std::string, std::string> readGrammarRules(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) throw std::runtime_error("Could not open file " + filename);
+
+    std::map<std::string, std::string> rules;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t arrow = line.find("→");
+        if (arrow == std::string::npos || trim(line).rfind("//", 0) == 0) continue;
+        rules[trim(line.substr(0, arrow))] = trim(line.substr(arrow + std::string("→").size()));
+    }
+    return rules;
+}
+
+// The state reached inside an identifier that can no longer become a keyword:
+// it accepts IDENTIFIER and loops to itself on every [a-zA-Z0-9_] byte, so the
+// lexer may skip the rest of the run in bulk. Returns the dead state if none.
+static int identifierRunState(const Dfa& dfa, const std::vector<TokenRule>& rules) {
+    for (size_t s = 1; s < dfa.transitions.size(); ++s) {
+        int rule = dfa.acceptRule[s];
+        if (rule < 0 || rules[rule].tokenType != "IDENTIFIER") continue;
+
+        bool loops = true;
+        for (int byte = 0; byte < 256 && loops; ++byte) {
+            bool word = std::isalnum(byte) || byte == '_';
+            if (word && dfa.transitions[s][byte] != static_cast<int>(s)) loops = false;
+        }
+        if (loops) return static_cast<int>(s);
+    }
+    return 0;
+}
+
+static void writeTables(const std::string& filename, const Dfa& dfa,
+                        const std::vector<TokenRule>& rules, size_t nfaSize, size_t rawDfaSize) {
+    if (dfa.transitions.size() > 256) {
+        throw std::runtime_error("DFA has more than 256 states; widen the transition type");
+    }
+
+    std::ofstream out(filename);
+    if (!out.is_open()) throw std::runtime_error("Could not open file " + filename + " for writing");
+
+    out << "// Generated by lexgen from grammar.txt. Do not edit.\n";
+    out << "// NFA states: " << nfaSize << ", DFA states: " << rawDfaSize
+        << ", minimized: " << dfa.transitions.size() << "\n\n";
+    out << "#include \"lexer_tables.h\"\n\n";
+    out << "namespace LexerTables {\n\n";
+    out << "const int numStates = " << dfa.transitions.size() << ";\n";
+    out << "const unsigned char startState = " << dfa.start << ";\n";
+    out << "const unsigned char identifierRunState = " << identifierRunState(dfa, rules) << ";\n\n";
+
+    out << "const TokenType acceptType[] = {\n";
+    for (size_t s = 0; s < dfa.acceptRule.size(); ++s) {
+        int rule = dfa.acceptRule[s];
+        out << "    TokenType::" << (rule < 0 ? "ERROR" : rules[rule].tokenType) << ",  // " << s << "\n";
+    }
+    out << "};\n\n";
+
+    out << "const unsigned char transitions[][256] = {\n";
+    for (size_t s = 0; s < dfa.transitions.size(); ++s) {
+        out << "    {";
+        for (int byte = 0; byte < 256; ++byte) {
+            if (byte % 32 == 0) out << "\n        ";
+            out << dfa.transitions[s][byte] << (byte < 255 ? "," : "");
+        }
+        out << "\n    },\n";
+    }
+    out << "};\n\n";
+    out << "} // namespace LexerTables\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <grammar.txt> <output.cpp>" << std::endl;
+        return 1;
+    }
+
+    try {
+        std::map<std::string, std::string> grammarRules = readGrammarRules(argv[1]);
+
+        std::vector<TokenRule> rules;
+        for (const auto& literal : literalTokens) {
+            rules.push_back({literal.second, literal.first, true});
+        }
+        for (const auto& terminal : regexTerminals) {
+            auto it = grammarRules.find(terminal.first);
+            if (it == grammarRules.end()) {
+                throw std::runtime_error("Terminal " + terminal.first + " is not defined in " + argv[1]);
+            }
+            rules.push_back({terminal.second, it->second, false});
+        }
+
+        // One NFA with an epsilon edge from the start state into every rule
+        std::vector<NfaState> nfa(1);
+        for (size_t i = 0; i < rules.size(); ++i) {
+            NfaBuilder builder(nfa, rules[i].pattern);
+            NfaFragment f = rules[i].isLiteral ? builder.buildLiteral() : builder.buildRegex();
+            nfa[f.end].acceptRule = static_cast<int>(i);
+            nfa[0].epsilon.push_back(f.start);
+        }
+
+        Dfa dfa = buildDfa(nfa, 0);
+        Dfa minimized = minimizeDfa(dfa);
+        writeTables(argv[2], minimized, rules, nfa.size(), dfa.transitions.size());
+
+        std::cout << "lexgen: " << rules.size() << " token rules, "
+                  << minimized.transitions.size() << " DFA states -> " << argv[2] << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "lexgen: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -3,10 +3,22 @@
 #include "error_handler.h"
 #include "grammar.h"
 #include "parser.h"
+#include "rd_parser.h"
+#include "lalr_parser.h"
 #include <iostream>
 #include <memory>
 #include <string>
 #include <fstream>
+#include <filesystem>
+#include <charconv>
+
+// Parse the N of an option such as --threads=N: decimal digits only
+template <typename T>
+static bool parseCount(const std::string& text, T& value) {
+    const char* last = text.data() + text.size();
+    auto result = std::from_chars(text.data(), last, value);
+    return !text.empty() && result.ec == std::errc() && result.ptr == last;
+}
 
 int main(int argc, char* argv[]) {
     // Create components with shared ownership
@@ -24,13 +36,87 @@ int main(int argc, char* argv[]) {
     // Create parser
     auto parser = std::make_shared<Parser>(lexer, symbolTable, errorHandler, grammar);
     
-    // Process input file
+    // Process command line: options start with "--", anything else is the input file
     std::string inputFile;
+    bool streamInput = false;
+    std::string parserKind = "ll1";
+    std::string grammarFile;
+    
+    auto printUsage = [&]() {
+        std::cerr << "Usage: " << argv[0] << " [--lexer=regex|table] [--threads=N] [--lazy] [--stream] [--grammar=FILE] [--parser=ll1|rd|lalr] [--max-errors=N] [--trace=none|stages|debug] [--trace-file=FILE] [input_file]" << std::endl;
+    };
+    
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--lexer=regex") {
+            lexer->setMode(LexerMode::REGEX);
+        } else if (arg == "--lexer=table") {
+            lexer->setMode(LexerMode::TABLE);
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            unsigned threads;
+            if (!parseCount(arg.substr(10), threads)) {
+                std::cerr << "Invalid thread count: " << arg << std::endl;
+                printUsage();
+                return 1;
+            }
+            lexer->setThreadCount(threads);
+            parser->setThreadCount(threads);
+        } else if (arg == "--lazy") {
+            lexer->setLazy(true);
+        } else if (arg == "--stream") {
+            streamInput = true;
+        } else if (arg == "--trace=none") {
+            parser->setTraceLevel(TraceLevel::NONE);
+        } else if (arg == "--trace=stages") {
+            parser->setTraceLevel(TraceLevel::STAGES);
+        } else if (arg == "--trace=debug") {
+            parser->setTraceLevel(TraceLevel::DEBUG);
+        } else if (arg.rfind("--trace-file=", 0) == 0) {
+            auto recorder = std::make_shared<ParseTraceRecorder>(arg.substr(13));
+            if (!recorder->isOpen()) {
+                std::cerr << "Error: Could not open " << arg.substr(13) << " for writing" << std::endl;
+                return 1;
+            }
+            parser->setTraceRecorder(recorder);
+        } else if (arg.rfind("--max-errors=", 0) == 0) {
+            size_t budget;
+            if (!parseCount(arg.substr(13), budget)) {
+                std::cerr << "Invalid error limit: " << arg << std::endl;
+                printUsage();
+                return 1;
+            }
+            parser->setErrorBudget(budget);
+        } else if (arg.rfind("--grammar=", 0) == 0) {
+            grammarFile = arg.substr(10);
+        } else if (arg == "--parser=ll1" || arg == "--parser=rd" || arg == "--parser=lalr") {
+            parserKind = arg.substr(9);
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage();
+            return 1;
+        } else {
+            // Use file provided as command line argument
+            inputFile = arg;
+        }
+    }
     
-    if (argc > 1) {
-        // Use file provided as command line argument
-        inputFile = argv[1];
-    } else {
+    // The recursive-descent parser is generated from the built-in grammar
+    if (parserKind == "rd" && !grammarFile.empty()) {
+        std::cerr << "Error: --parser=rd only parses the built-in grammar; it cannot be used with --grammar="
+                  << grammarFile << std::endl;
+        printUsage();
+        return 1;
+    }
+    if (!grammarFile.empty()) {
+        try {
+            grammar->loadFromFile(grammarFile);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    
+    if (inputFile.empty()) {
         // Use default sample file
         inputFile = "sample_correct.txt";
         std::cout << "No input file specified. Using default: " << inputFile << std::endl;
@@ -46,12 +132,39 @@ int main(int argc, char* argv[]) {
     }
     checkFile.close();
     
+    // Streaming mode: lexical analysis only, with memory use independent of file size
+    if (streamInput) {
+        std::cout << "\nStreaming lexical analysis on " << inputFile << "..." << std::endl;
+        std::filesystem::create_directories("output");
+        std::ofstream tokensFile("output/tokens.txt");
+        std::ofstream tokenStreamFile("output/token_stream.txt");
+        tokensFile << "Token Type,Lexeme,Line,Column\n";
+        
+        size_t tokenCount = 0;
+        lexer->tokenizeStream(inputFile, [&](const Token& token) {
+            LexicalAnalyzer::writeTokenDetail(tokensFile, token, lexer->locate(token.offset));
+            LexicalAnalyzer::writeTokenStreamEntry(tokenStreamFile, token);
+            tokenCount++;
+        });
+        
+        std::cout << "  " << tokenCount << " tokens written to output/tokens.txt and output/token_stream.txt" << std::endl;
+        if (errorHandler->hasCompileErrors()) {
+            errorHandler->printErrors();
+            errorHandler->writeErrorsToFile("output/errors.txt");
+        }
+        std::cout << "  Parsing is skipped in streaming mode." << std::endl;
+        return errorHandler->hasCompileErrors() ? 1 : 0;
+    }
+    
     // Step 1: Perform lexical analysis
     std::cout << "\nStep 1: Performing lexical analysis on " << inputFile << "..." << std::endl;
     lexer->tokenizeFile(inputFile);
     
     // Report lexical errors (if any)
-    if (errorHandler->hasCompileErrors()) {
+    if (lexer->isLazy()) {
+        std::cout << "  Lazy mode: tokens will be produced on demand during parsing." << std::endl;
+        std::cout << "  Lexical errors are reported with the parse; no token files are written." << std::endl;
+    } else if (errorHandler->hasCompileErrors()) {
         std::cout << "  Lexical errors detected!" << std::endl;
         errorHandler->printErrors();
     } else {
@@ -60,17 +173,40 @@ int main(int argc, char* argv[]) {
     
     // Step 2: Generate FIRST and FOLLOW sets
     std::cout << "\nStep 2: Generating FIRST and FOLLOW sets..." << std::endl;
+    if (grammar->isCompiled()) {
+        std::cout << "  Grammar loaded from its cache; no analysis needed" << std::endl;
+    }
     parser->generateFirstAndFollowSets();
     std::cout << "  FIRST and FOLLOW sets written to first_follow.txt" << std::endl;
     
-    // Step 3: Generate parse table
-    std::cout << "\nStep 3: Generating parse table..." << std::endl;
-    parser->generateParseTable();
-    std::cout << "  Parse table written to parse_table.txt" << std::endl;
+    // Step 3: Generate parse table. The LALR(1) parser builds its own
+    // tables, so its grammar need not be LL(1).
+    std::unique_ptr<LalrParser> lalrParser;
+    if (parserKind == "lalr") {
+        std::cout << "\nStep 3: Generating LALR(1) tables..." << std::endl;
+        lalrParser = std::make_unique<LalrParser>(lexer, symbolTable, errorHandler, grammar);
+        lalrParser->generateTables();
+        std::cout << "  " << lalrParser->getStateCount() << " states, " << lalrParser->getConflictCount()
+                  << " conflicts" << std::endl;
+    } else {
+        std::cout << "\nStep 3: Generating parse table..." << std::endl;
+        parser->generateParseTable();
+        std::cout << "  Parse table written to parse_table.txt" << std::endl;
+    }
     
     // Step 4: Perform parsing
     std::cout << "\nStep 4: Performing parsing..." << std::endl;
-    bool parseSuccess = parser->parse();
+    bool parseSuccess;
+    if (parserKind == "rd") {
+        // Generated recursive-descent parser: same result, no parsing stages trace
+        RecursiveDescentParser rdParser(lexer, symbolTable, errorHandler);
+        parseSuccess = rdParser.parse();
+    } else if (lalrParser) {
+        // Shift/reduce parser on LALR(1) tables built from the same grammar
+        parseSuccess = lalrParser->parse();
+    } else {
+        parseSuccess = parser->parse();
+    }
     
     if (parseSuccess && !errorHandler->hasCompileErrors()) {
         std::cout << "  Parsing completed successfully." << std::endl;
@@ -87,11 +223,19 @@ int main(int argc, char* argv[]) {
     
     // Print output file locations
     std::cout << "\nOutput files generated in the 'output' directory:" << std::endl;
-    std::cout << " - output/tokens.txt: Detailed token information" << std::endl;
-    std::cout << " - output/token_stream.txt: Token stream for parser" << std::endl;
+    if (!lexer->isLazy()) {
+        std::cout << " - output/tokens.txt: Detailed token information" << std::endl;
+        std::cout << " - output/token_stream.txt: Token stream for parser" << std::endl;
+    }
     std::cout << " - output/first_follow.txt: FIRST and FOLLOW sets" << std::endl;
-    std::cout << " - output/parse_table.txt: LL(1) parsing table" << std::endl;
-    std::cout << " - output/parsing_stages.txt: Step-by-step parsing process" << std::endl;
+    if (parserKind == "ll1") {
+        std::cout << " - output/parse_table.txt: LL(1) parsing table" << std::endl;
+        std::cout << " - output/parsing_stages.txt: Step-by-step parsing process" << std::endl;
+    } else if (parserKind == "rd") {
+        std::cout << " - output/parse_table.txt: LL(1) parsing table" << std::endl;
+        std::cout << " - output/parsing_stages.txt: Header only; the recursive-descent parser writes no parsing stages"
+                  << std::endl;
+    }
     std::cout << " - output/symbol_table.txt: Symbol table entries" << std::endl;
     
     if (errorHandler->hasCompileErrors()) {
@@ -0,0 +1,289 @@
+#include "parse_trace.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+constexpr char ParseTraceRecorder::magic[4];
+
+namespace {
+
+// Append the bytes of a table to a grammar section
+template <typename T>
+void appendTable(std::string& bytes, const std::vector<T>& table) {
+    bytes.append(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(T));
+}
+
+// Grammar section of a trace (see TraceGrammarHeader)
+std::string encodeGrammar(const TraceGrammar& grammar) {
+    std::string names;
+    for (const auto* list : {&grammar.terminalNames, &grammar.nonTerminalNames, &grammar.productionTexts}) {
+        for (const auto& name : *list) {
+            names += name;
+            names += '\0';
+        }
+    }
+    
+    TraceGrammarHeader counts;
+    counts.terminalCount = static_cast<uint32_t>(grammar.terminalNames.size());
+    counts.nonTerminalCount = static_cast<uint32_t>(grammar.nonTerminalNames.size());
+    counts.productionCount = static_cast<uint32_t>(grammar.productionTexts.size());
+    counts.pushSymbolCount = static_cast<uint32_t>(grammar.pushSymbols.size());
+    counts.tokenTypeCount = static_cast<uint32_t>(grammar.tokenTerminals.size());
+    counts.namesSize = static_cast<uint32_t>(names.size());
+    counts.startSymbol = grammar.startSymbol;
+    counts.endMarker = grammar.endMarker;
+    
+    // A trace begun before any parse has no grammar, but still one pushStart entry
+    std::string bytes(reinterpret_cast<const char*>(&counts), sizeof(counts));
+    appendTable(bytes, grammar.pushStart.empty() ? std::vector<uint32_t>(1, 0) : grammar.pushStart);
+    appendTable(bytes, grammar.pushSymbols);
+    appendTable(bytes, grammar.parseTable);
+    appendTable(bytes, grammar.tokenTerminals);
+    return bytes + names;
+}
+
+// Read a table of a grammar section
+template <typename T>
+bool readTable(std::FILE* file, std::vector<T>& table, size_t count) {
+    table.resize(count);
+    return std::fread(table.data(), sizeof(T), count, file) == count;
+}
+
+// Whether a symbol is a terminal of the grammar, or a non-terminal
+bool isTerminal(const TraceGrammar& grammar, uint16_t symbol) {
+    return (symbol & TraceGrammar::terminalBit) &&
+           (symbol & ~TraceGrammar::terminalBit) < grammar.terminalNames.size();
+}
+
+bool isNonTerminal(const TraceGrammar& grammar, uint16_t symbol) {
+    return !(symbol & (TraceGrammar::terminalBit | TraceGrammar::actionBit)) &&
+           symbol < grammar.nonTerminalNames.size();
+}
+
+// Read the grammar section, and check that every id and table entry is in range
+bool decodeGrammar(std::FILE* file, uint32_t size, TraceGrammar& grammar) {
+    TraceGrammarHeader counts;
+    if (size < sizeof(counts) || std::fread(&counts, sizeof(counts), 1, file) != 1) return false;
+    
+    // Symbol ids leave 14 bits for the index, and the table holds int16 production indices
+    constexpr uint32_t maxSymbols = TraceGrammar::actionBit;
+    if (counts.terminalCount > maxSymbols || counts.nonTerminalCount > maxSymbols ||
+        counts.productionCount > 0x7FFF || counts.tokenTypeCount > 256) {
+        return false;
+    }
+    uint64_t tableSize = uint64_t(counts.nonTerminalCount) * counts.terminalCount;
+    uint64_t expected = sizeof(counts) + (uint64_t(counts.productionCount) + 1) * sizeof(uint32_t) +
+                        uint64_t(counts.pushSymbolCount) * sizeof(uint16_t) + tableSize * sizeof(int16_t) +
+                        uint64_t(counts.tokenTypeCount) * sizeof(uint16_t) + counts.namesSize;
+    if (expected != size) return false;
+    
+    std::string names(counts.namesSize, '\0');
+    if (!readTable(file, grammar.pushStart, counts.productionCount + 1) ||
+        !readTable(file, grammar.pushSymbols, counts.pushSymbolCount) ||
+        !readTable(file, grammar.parseTable, static_cast<size_t>(tableSize)) ||
+        !readTable(file, grammar.tokenTerminals, counts.tokenTypeCount) ||
+        std::fread(&names[0], 1, names.size(), file) != names.size()) {
+        return false;
+    }
+    
+    // Names: one '\0'-ended string each
+    size_t position = 0;
+    for (auto [list, count] : {std::pair{&grammar.terminalNames, counts.terminalCount},
+                               std::pair{&grammar.nonTerminalNames, counts.nonTerminalCount},
+                               std::pair{&grammar.productionTexts, counts.productionCount}}) {
+        list->clear();
+        for (uint32_t i = 0; i < count; ++i) {
+            size_t end = names.find('\0', position);
+            if (end == std::string::npos) return false;
+            list->push_back(names.substr(position, end - position));
+            position = end + 1;
+        }
+    }
+    if (position != names.size()) return false;
+    
+    grammar.startSymbol = counts.startSymbol;
+    grammar.endMarker = counts.endMarker;
+    bool noGrammar = counts.nonTerminalCount == 0;
+    if ((!noGrammar && (!isNonTerminal(grammar, grammar.startSymbol) || !isTerminal(grammar, grammar.endMarker))) ||
+        grammar.pushStart.front() != 0 || grammar.pushStart.back() != grammar.pushSymbols.size()) {
+        return false;
+    }
+    for (size_t p = 0; p < counts.productionCount; ++p) {
+        if (grammar.pushStart[p] > grammar.pushStart[p + 1]) return false;
+    }
+    for (uint16_t symbol : grammar.pushSymbols) {
+        bool action = (symbol & TraceGrammar::actionBit) && !(symbol & TraceGrammar::terminalBit);
+        if (!action && !isTerminal(grammar, symbol) && !isNonTerminal(grammar, symbol)) return false;
+    }
+    for (int16_t production : grammar.parseTable) {
+        if (production < -1 || production >= static_cast<int32_t>(counts.productionCount)) return false;
+    }
+    for (uint16_t terminal : grammar.tokenTerminals) {
+        if (terminal != TraceGrammar::noSymbol && !isTerminal(grammar, terminal)) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+// Constructor
+ParseTraceRecorder::ParseTraceRecorder(const std::string& path, size_t bufferRecords, size_t bufferTokens)
+    : file(std::fopen(path.c_str(), "wb")), header(), fileSize(0), filling(0), next(nullptr), limit(nullptr),
+      nextToken(nullptr), tokenLimit(nullptr), handedRecords(0), handedTokens(0), pendingBlock(),
+      pending(false), stopping(false) {
+    for (auto& buffer : buffers) {
+        buffer.records.resize(std::max<size_t>(bufferRecords, 1));
+        buffer.tokens.resize(std::max<size_t>(bufferTokens, 1));
+    }
+    
+    // Blocks are already large; stdio's own buffer would only copy them again
+    if (file) {
+        std::setvbuf(file, nullptr, _IONBF, 0);
+        writer = std::thread(&ParseTraceRecorder::writeBlocks, this);
+    }
+    begin(TraceGrammar());
+}
+
+// Destructor
+ParseTraceRecorder::~ParseTraceRecorder() {
+    if (file) {
+        finish();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        writer.join();
+        std::fclose(file);
+    }
+}
+
+// Start a new trace
+void ParseTraceRecorder::begin(const TraceGrammar& grammar) {
+    drain();
+    std::string grammarBytes = encodeGrammar(grammar);
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = version;
+    header.recordSize = sizeof(TraceRecord);
+    header.grammarSize = static_cast<uint32_t>(grammarBytes.size());
+    header.reserved = 0;
+    header.recordCount = 0;
+    header.tokenCount = 0;
+    fileSize = sizeof(header) + grammarBytes.size();
+    handedRecords = 0;
+    handedTokens = 0;
+    next = buffers[filling].records.data();
+    limit = next + buffers[filling].records.size();
+    nextToken = buffers[filling].tokens.data();
+    tokenLimit = nextToken + buffers[filling].tokens.size();
+    
+    if (file) {
+        std::rewind(file);
+        std::fwrite(&header, sizeof(header), 1, file);
+        std::fwrite(grammarBytes.data(), 1, grammarBytes.size(), file);
+        std::fflush(file);
+    }
+}
+
+// Hand the filled part of the buffers to the writer and record into the
+// other pair, once the writer is done with it
+void ParseTraceRecorder::flush() {
+    TraceBlockHeader block;
+    block.recordCount = static_cast<uint32_t>(next - buffers[filling].records.data());
+    block.tokenCount = static_cast<uint32_t>(nextToken - buffers[filling].tokens.data());
+    if (file && (block.recordCount > 0 || block.tokenCount > 0)) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return !pending; });
+        pendingBlock = block;
+        pending = true;
+        filling ^= 1;
+        changed.notify_all();
+    }
+    handedRecords += block.recordCount;
+    handedTokens += block.tokenCount;
+    next = buffers[filling].records.data();
+    limit = next + buffers[filling].records.size();
+    nextToken = buffers[filling].tokens.data();
+    tokenLimit = nextToken + buffers[filling].tokens.size();
+}
+
+// Writer thread: write each block handed over, then rewrite the header
+// with the new counts so the file is a valid trace after every block
+void ParseTraceRecorder::writeBlocks() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        changed.wait(lock, [this] { return pending || stopping; });
+        if (!pending) return;
+        
+        // The parse thread does not touch the other buffers until pending is cleared
+        const Buffer& buffer = buffers[filling ^ 1];
+        TraceBlockHeader block = pendingBlock;
+        lock.unlock();
+        std::fseek(file, static_cast<long>(fileSize), SEEK_SET);
+        std::fwrite(&block, sizeof(block), 1, file);
+        std::fwrite(buffer.records.data(), sizeof(TraceRecord), block.recordCount, file);
+        std::fwrite(buffer.tokens.data(), 1, block.tokenCount, file);
+        fileSize += sizeof(block) + block.recordCount * sizeof(TraceRecord) + block.tokenCount;
+        header.recordCount += block.recordCount;
+        header.tokenCount += block.tokenCount;
+        std::rewind(file);
+        std::fwrite(&header, sizeof(header), 1, file);
+        lock.lock();
+        
+        pending = false;
+        changed.notify_all();
+    }
+}
+
+// Wait until the writer has written everything handed to it
+void ParseTraceRecorder::drain() {
+    if (!file) return;
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !pending; });
+}
+
+// Write everything recorded so far
+void ParseTraceRecorder::finish() {
+    flush();
+    drain();
+    if (file) {
+        std::fflush(file);
+    }
+}
+
+// Load a trace
+ParseTraceReader::ParseTraceReader(const std::string& path) : header() {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Could not open trace file " + path);
+    }
+    
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                 std::memcmp(header.magic, ParseTraceRecorder::magic, sizeof(header.magic)) == 0 &&
+                 header.version == ParseTraceRecorder::version &&
+                 header.recordSize == sizeof(TraceRecord) &&
+                 decodeGrammar(file, header.grammarSize, grammar);
+    
+    // Join the blocks, up to the counts in the header
+    while (valid && (records.size() < header.recordCount || tokens.size() < header.tokenCount)) {
+        TraceBlockHeader block;
+        valid = std::fread(&block, sizeof(block), 1, file) == 1 &&
+                block.recordCount <= header.recordCount - records.size() &&
+                block.tokenCount <= header.tokenCount - tokens.size();
+        if (valid) {
+            size_t recordStart = records.size();
+            size_t tokenStart = tokens.size();
+            records.resize(recordStart + block.recordCount);
+            tokens.resize(tokenStart + block.tokenCount);
+            valid = std::fread(records.data() + recordStart, sizeof(TraceRecord), block.recordCount, file) ==
+                        block.recordCount &&
+                    std::fread(tokens.data() + tokenStart, 1, block.tokenCount, file) == block.tokenCount;
+        }
+    }
+    std::fclose(file);
+    
+    if (!valid) {
+        throw std::runtime_error(path + " is not a parse trace (or is truncated)");
+    }
+}
@@ -0,0 +1,195 @@
+#ifndef PARSE_TRACE_H
+#define PARSE_TRACE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Step of the parse loop recorded in a binary trace. Each one corresponds
+// to one row of the parsing stages table.
+//
+// Matches and expansions are not recorded: the trace also holds the
+// grammar's parse table and the type of every token the parser read, and
+// with those the steps follow from the stack and the current token. Only
+// the steps the table does not decide are recorded. Recovery always ends
+// in a RESUME or RECOVERY_EOF record, and the tokens it skips are not
+// matched.
+enum class TraceAction : uint8_t {
+    START,          // Initial stack setup
+    MISMATCH,       // Terminal mismatch; argument: expected terminal
+    NO_PRODUCTION,  // No production for the token; argument: the non-terminal
+    BUDGET,         // Error budget used up
+    RESUME,         // Recovery resynchronized
+    RECOVERY_EOF,   // Recovery ran out of input
+    ACCEPT,         // Accepted
+    FINISHED,       // Reached the end with errors; argument: error count
+    TRAILING        // Input left after the stack emptied
+};
+
+// One recorded parse step, 12 bytes. The depth delta is the change in
+// stack size since the previous record, which lets readers check their
+// replay and tells them where recovery cut the stack.
+struct TraceRecord {
+    uint32_t tokenIndex;    // Index of the current token in the token stream
+    uint16_t argument;      // See TraceAction
+    int16_t depthDelta;
+    TraceAction action;
+    uint8_t tokenType;      // TokenType of the current token
+    uint16_t reserved;
+};
+
+static_assert(sizeof(TraceRecord) == 12, "TraceRecord should stay 12 bytes");
+
+// Grammar that was parsed, numbered as Parser numbers it: non-terminal i
+// is symbol i, terminal j is terminalBit | j, and push sequences may hold
+// semantic actions (actionBit | action), which readers skip.
+struct TraceGrammar {
+    static constexpr uint16_t terminalBit = 0x8000;
+    static constexpr uint16_t actionBit = 0x4000;
+    static constexpr uint16_t noSymbol = 0xFFFF;
+    
+    std::vector<std::string> terminalNames;
+    std::vector<std::string> nonTerminalNames;
+    std::vector<std::string> productionTexts;   // As the parsing stages table shows them
+    std::vector<uint32_t> pushStart;            // Production p pushes pushSymbols[pushStart[p]..pushStart[p + 1])
+    std::vector<uint16_t> pushSymbols;
+    std::vector<int16_t> parseTable;            // Production of [non-terminal][terminal], or -1, row by row
+    std::vector<uint16_t> tokenTerminals;       // Terminal of each TokenType, or noSymbol
+    uint16_t startSymbol = noSymbol;
+    uint16_t endMarker = noSymbol;
+};
+
+// File header of a binary trace. The grammar follows it (grammarSize
+// bytes), then blocks, each a TraceBlockHeader, its records, then its
+// token types (one byte each). The counts cover every block written so far.
+struct TraceHeader {
+    char magic[4];              // "PTRC"
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t grammarSize;
+    uint32_t reserved;
+    uint64_t recordCount;
+    uint64_t tokenCount;
+};
+
+// Start of the grammar section: its counts. The tables follow in the order
+// of TraceGrammar (pushStart, pushSymbols, parseTable, tokenTerminals),
+// then every name and production text, each ended by a '\0'.
+struct TraceGrammarHeader {
+    uint32_t terminalCount;
+    uint32_t nonTerminalCount;
+    uint32_t productionCount;
+    uint32_t pushSymbolCount;
+    uint32_t tokenTypeCount;
+    uint32_t namesSize;
+    uint16_t startSymbol;
+    uint16_t endMarker;
+};
+
+struct TraceBlockHeader {
+    uint32_t recordCount;
+    uint32_t tokenCount;
+};
+
+// Records parse steps to a file. Records and token types are collected in
+// fixed buffers, so recording a token is a one-byte store. Full buffers
+// are handed to a writer thread and the parse goes on in a second pair, so
+// the parse thread never waits for the disk unless the writer falls a
+// whole buffer behind.
+class ParseTraceRecorder {
+private:
+    struct Buffer {
+        std::vector<TraceRecord> records;
+        std::vector<uint8_t> tokens;
+    };
+    
+    std::FILE* file;
+    TraceHeader header;             // As last written; the writer's while a block is pending
+    uint64_t fileSize;              // Likewise
+    Buffer buffers[2];
+    size_t filling;                 // Buffer the parse thread records into
+    TraceRecord* next;              // Free record slot in it
+    TraceRecord* limit;
+    uint8_t* nextToken;             // Free token slot in it
+    uint8_t* tokenLimit;
+    uint64_t handedRecords;         // Records and tokens already given to the writer
+    uint64_t handedTokens;
+    
+    // Writer thread: writes the block of the buffer that is not filling,
+    // then clears `pending`
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable changed;
+    TraceBlockHeader pendingBlock;
+    bool pending;
+    bool stopping;
+    
+    void writeBlocks();
+    
+    // Hand the filled part of the buffers to the writer and switch buffers
+    // (without a file, the records are dropped)
+    void flush();
+    
+    // Wait until the writer has written everything handed to it
+    void drain();
+    
+public:
+    static constexpr char magic[4] = {'P', 'T', 'R', 'C'};
+    static constexpr uint16_t version = 3;
+    
+    // Open the trace file (buffer sizes in records and in tokens)
+    explicit ParseTraceRecorder(const std::string& path, size_t bufferRecords = 1024,
+                                size_t bufferTokens = 1 << 18);
+    ~ParseTraceRecorder();
+    
+    ParseTraceRecorder(const ParseTraceRecorder&) = delete;
+    ParseTraceRecorder& operator=(const ParseTraceRecorder&) = delete;
+    
+    bool isOpen() const { return file != nullptr; }
+    
+    // Start a new trace of a parse with this grammar, dropping any earlier records
+    void begin(const TraceGrammar& grammar);
+    
+    // Record a step
+    void record(const TraceRecord& step) {
+        *next++ = step;
+        if (next == limit) flush();
+    }
+    
+    // Record the type of the next token read
+    void recordToken(uint8_t tokenType) {
+        *nextToken++ = tokenType;
+        if (nextToken == tokenLimit) flush();
+    }
+    
+    // Write everything recorded so far
+    void finish();
+    
+    // Number of records and of tokens so far
+    uint64_t size() const { return handedRecords + (next - buffers[filling].records.data()); }
+    uint64_t tokenCount() const { return handedTokens + (nextToken - buffers[filling].tokens.data()); }
+};
+
+// Reads a binary trace written by ParseTraceRecorder
+class ParseTraceReader {
+private:
+    TraceHeader header;
+    TraceGrammar grammar;
+    std::vector<TraceRecord> records;
+    std::vector<uint8_t> tokens;
+    
+public:
+    // Load a trace; throws std::runtime_error if it is not a valid trace
+    explicit ParseTraceReader(const std::string& path);
+    
+    const TraceHeader& getHeader() const { return header; }
+    const TraceGrammar& getGrammar() const { return grammar; }
+    const std::vector<TraceRecord>& getRecords() const { return records; }
+    const std::vector<uint8_t>& getTokenTypes() const { return tokens; }
+};
+
+#endif // PARSE_TRACE_H
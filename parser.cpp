@@ -3,6 +3,48 @@
 #include <iostream>
 #include <algorithm>
 #include <sstream>
+#include <iterator>
+#include <cstring>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// Parse-table name of each TokenType, indexed by its enum value.
+// END_OF_FILE and ERROR match no terminal and are shown by their type name.
+const char* const tokenNames[] = {
+    "int", "float", "while", "main",
+    "+", "-", "*", "/",
+    "++", "--",
+    "=", "<", ">",
+    ";", ",", "(", ")",
+    "{", "}",
+    "ID", "CONST", "CONST",
+    "END_OF_FILE", "ERROR"
+};
+
+static_assert(std::size(tokenNames) == static_cast<size_t>(TokenType::ERROR) + 1,
+              "tokenNames must have one entry per TokenType");
+
+} // namespace
+
+// DEBUG lines of the parse loop, printed at TraceLevel::DEBUG. Building with
+// -DPARSER_NO_DEBUG (make PARSER_DEBUG=0) removes them from the binary.
+#ifdef PARSER_NO_DEBUG
+#define PARSER_DEBUG(message) do {} while (0)
+#else
+#define PARSER_DEBUG(message) \
+    do { if (traceLevel >= TraceLevel::DEBUG) std::cout << "DEBUG: " << message << std::endl; } while (0)
+#endif
+
+// Row of the parsing stages table. The arguments, stack rendering included,
+// are only evaluated when stages are traced.
+#define TRACE_STAGE(...) \
+    do { if (traceLevel >= TraceLevel::STAGES) writeParsingStage(__VA_ARGS__); } while (0)
+
+// Binary trace record of the same step
+#define RECORD_STEP(action, argument) \
+    do { if (recorder) recordStep(TraceAction::action, argument); } while (0)
 
 // Constructor
 Parser::Parser(std::shared_ptr<LexicalAnalyzer> lex, 
@@ -10,7 +52,14 @@ Parser::Parser(std::shared_ptr<LexicalAnalyzer> lex,
                std::shared_ptr<ErrorHandler> errHandler, 
                std::shared_ptr<Grammar> gram)
     : lexer(lex), symbolTable(symTab), errorHandler(errHandler), grammar(gram),
-      isInDeclaration(false) {
+      nonTerminalCount(0), terminalCount(0), endMarkerId(noSymbol), intId(noSymbol), floatId(noSymbol),
+      semicolonId(noSymbol), stmtsId(noSymbol), buildAst(false), openDecl(Ast::npos), incremental(false),
+      regionParse(false), programNode(Ast::npos), fullParseNodes(0), regionDepth(0), resumeCandidate(Ast::npos),
+      resumePosition(0), resumeFrom(0), resumed(false), pendingFirst(0), pendingEnd(0), threadCount(1),
+      parallelMinTokens(1 << 16), sliceParse(false), sliceEnd(SIZE_MAX), sliceTokens(nullptr), listFloor(0),
+      errorBudget(defaultErrorBudget), syntaxErrors(0), quietTokens(0), traceLevel(TraceLevel::DEBUG),
+      tokenIndex(0), tokensRead(0), recordedDepth(0), isInDeclaration(false) {
+    tokenTerminals.fill(noSymbol);
     
     // Create output directory if it doesn't exist
     #ifdef _WIN32
@@ -40,17 +89,44 @@ Parser::Parser(std::shared_ptr<LexicalAnalyzer> lex,
     parsingStagesFile << "|---------------|---------------|-----------------|--------|\n";
 }
 
+// Worker for a parallel parse: the parent's tables, no symbol table, error
+// handler or output files, and no tracing
+Parser::Parser(const Parser& parent, const TokenStore& tokens)
+    : lexer(parent.lexer), grammar(parent.grammar),
+      nonTerminalCount(parent.nonTerminalCount), terminalCount(parent.terminalCount),
+      nonTerminalNames(parent.nonTerminalNames), terminalNames(parent.terminalNames),
+      parseTable(parent.parseTable), pushSymbols(parent.pushSymbols), pushStart(parent.pushStart),
+      tokenTerminals(parent.tokenTerminals), endMarkerId(parent.endMarkerId), intId(parent.intId),
+      floatId(parent.floatId), semicolonId(parent.semicolonId), stmtsId(parent.stmtsId),
+      followTable(parent.followTable), buildAst(false), openDecl(Ast::npos), incremental(parent.incremental),
+      regionParse(false), programNode(Ast::npos), fullParseNodes(0), regionDepth(0), resumeCandidate(Ast::npos),
+      resumePosition(0), resumeFrom(0), resumed(false), pendingFirst(0), pendingEnd(0), threadCount(1),
+      parallelMinTokens(0), sliceParse(true), sliceEnd(SIZE_MAX), sliceTokens(&tokens), listFloor(0),
+      errorBudget(0), syntaxErrors(0), quietTokens(0), traceLevel(TraceLevel::NONE),
+      tokenIndex(0), tokensRead(0), recordedDepth(0), isInDeclaration(false) {}
+
 // Handle identifier tokens based on context
 void Parser::handleIdentifier(const Token& token) {
-    if (isInDeclaration) {
+    // A worker of a parallel parse leaves the checks to parseInParallel,
+    // and a reparse to recheckNames
+    if (sliceParse || regionParse) {
+        sliceNames.emplace_back(tokenIndex, isInDeclaration);
+        return;
+    }
+    checkName(token, isInDeclaration);
+}
+
+// Declare a name, or check that it was declared
+void Parser::checkName(const Token& token, bool declaring) {
+    if (declaring) {
         // Only insert into symbol table if this is a declaration
-        symbolTable->insert(token.lexeme, token.line, token.column);
+        symbolTable->insert(token.value, token.offset);
     } else {
         // For references, check if the variable exists
-        if (!symbolTable->exists(token.lexeme)) {
+        if (!symbolTable->exists(token.value)) {
             if (errorHandler) {
-                errorHandler->semanticError("Use of undeclared variable '" + token.lexeme + "'",
-                                         token.line, token.column);
+                errorHandler->semanticError("Use of undeclared variable '" + std::string(token.lexeme) + "'",
+                                         token.offset);
             }
         }
     }
@@ -58,118 +134,361 @@ void Parser::handleIdentifier(const Token& token) {
 
 // Parse the input
 bool Parser::parse() {
+    // Untraced parses of large inputs can be split across threads
+    bool accepted;
+    if (threadCount > 1 && parseInParallel(accepted)) {
+        return accepted;
+    }
+    
+    if (recorder) {
+        if (pushStart.empty()) {
+            initParseTable();
+        }
+        recorder->begin(traceGrammar());
+    }
+    
+    accepted = parseTokens();
+    
+    if (recorder) {
+        recorder->finish();
+    }
+    return accepted;
+}
+
+// Run the parse loop over the whole input
+bool Parser::parseTokens() {
+    // Parsing without a generated table fails on the first non-terminal
+    if (pushStart.empty()) {
+        initParseTable();
+    }
+    
+    // The semantic actions that build the tree exist only in the built-in grammar
+    buildAst = grammar->isBuiltin();
+    ast.clear();
+    ast.setKeepSpans(incremental && buildAst);
+    values.clear();
+    openLists.clear();
+    openDecl = Ast::npos;
+    syntaxErrors = 0;
+    quietTokens = 0;
+    isInDeclaration = false;
+    tokensRead = 0;
+    recordedDepth = 0;
+    
     // Initialize stack with start symbol and EOF marker
-    while (!parseStack.empty()) parseStack.pop();
-    parseStack.push("$");  // End marker
-    parseStack.push(grammar->getStartSymbol().name);
+    parseStack.clear();
+    parseStack.push_back(endMarkerId);  // End marker
+    parseStack.push_back(symbolId(grammar->getStartSymbol().name));
     
     // Get first token
     advance();
     
     // Debug output
-    std::cout << "DEBUG: Start Symbol = " << grammar->getStartSymbol().name << std::endl;
-    std::cout << "DEBUG: First Token = " << currentToken.getTypeAsString() << ", lexeme = '" << currentToken.lexeme << "'" << std::endl;
+    PARSER_DEBUG("Start Symbol = " << grammar->getStartSymbol().name);
+    PARSER_DEBUG("First Token = " << currentToken.getTypeAsString() << ", lexeme = '" << currentToken.lexeme << "'");
     
     // Begin parsing
-    writeParsingStage(stackToString(parseStack), tokenToString(currentToken), "", "Initial stack setup");
+    TRACE_STAGE(stackToString(), tokenToString(currentToken), "", "Initial stack setup");
+    RECORD_STEP(START, 0);
+    
+    bool accepted = runParseLoop();
+    
+    // An incremental parse keeps the tree for reparse()
+    programNode = ast.getRoot();
+    fullParseNodes = ast.size();
+    pendingFirst = pendingEnd = 0;
+    return accepted;
+}
+
+// Parse the Program's statements on several threads. Returns false, with
+// nothing parsed or reported, if the input is too small or not shaped like
+// a Program, or if a slice has a syntax error: the caller then parses it
+// sequentially.
+bool Parser::parseInParallel(bool& accepted) {
+    if (!grammar->isBuiltin() || lexer->isLazy() || traceLevel != TraceLevel::NONE || recorder ||
+        pushStart.empty()) {
+        return false;
+    }
+    const TokenStore& tokens = lexer->getTokens();
+    const size_t count = tokens.size();
+    if (count < std::max<size_t>(parallelMinTokens, 7)) {
+        return false;
+    }
     
+    // "int main ( ) {" statements "}" and the end of the input
+    static const TokenType header[] = {TokenType::INT, TokenType::MAIN, TokenType::LEFT_PAREN,
+                                       TokenType::RIGHT_PAREN, TokenType::LEFT_BRACE};
+    for (size_t i = 0; i < 5; ++i) {
+        if (tokens.type(i) != header[i]) return false;
+    }
+    const size_t bodyStart = 5;
+    const size_t close = count - 2;
+    if (tokens.type(close) != TokenType::RIGHT_BRACE || tokens.type(count - 1) != TokenType::END_OF_FILE) {
+        return false;
+    }
+    
+    // Pre-pass: split the statement list into about equal slices, at the end
+    // of top-level statements (a ';' or '}' outside any block). A slice also
+    // needs the declaration state at its start: whether an 'int' or 'float'
+    // was matched after the last ';' (see the parse loop).
+    struct Slice {
+        size_t first;
+        size_t end;
+        bool declaring;
+    };
+    std::vector<Slice> slices = {{bodyStart, close, true}};  // Declaring after "int main"
+    const uint8_t* types = tokens.typeArray().data();
+    size_t target = bodyStart + (close - bodyStart) / threadCount;
+    size_t depth = 0;
+    bool declaring = true;
+    for (size_t i = bodyStart; i < close; ++i) {
+        switch (static_cast<TokenType>(types[i])) {
+            case TokenType::LEFT_BRACE:
+                depth++;
+                continue;
+            case TokenType::RIGHT_BRACE:
+                if (depth == 0) return false;
+                depth--;
+                break;
+            case TokenType::SEMICOLON:
+                declaring = false;
+                break;
+            case TokenType::INT:
+            case TokenType::FLOAT:
+                declaring = true;
+                continue;
+            default:
+                continue;
+        }
+        if (depth == 0 && i + 1 >= target && i + 1 < close) {
+            slices.back().end = i + 1;
+            slices.push_back({i + 1, close, declaring});
+            target = bodyStart + (close - bodyStart) * slices.size() / threadCount;
+        }
+    }
+    if (depth != 0 || slices.size() < 2) {
+        return false;
+    }
+    
+    std::vector<std::unique_ptr<Parser>> workers(slices.size());
+    std::vector<uint8_t> parsed(slices.size(), 0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < slices.size(); ++i) {
+        threads.emplace_back([this, &tokens, &slices, &workers, &parsed, i]() {
+            workers[i].reset(new Parser(*this, tokens));
+            parsed[i] = workers[i]->parseSlice(slices[i].first, slices[i].end, slices[i].declaring);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (uint8_t ok : parsed) {
+        if (!ok) return false;
+    }
+    
+    // Names in source order, as the sequential parse checks them
+    for (const auto& worker : workers) {
+        for (const auto& name : worker->sliceNames) {
+            checkName(tokens.token(name.first), name.second);
+        }
+    }
+    
+    // Trees in source order. The arenas end up as a sequential parse builds
+    // them; the first statement of each slice counts its span offset from
+    // the last statement of the slice before.
+    size_t nodes = 1;
+    for (const auto& worker : workers) {
+        nodes += worker->ast.size();
+    }
+    buildAst = true;
+    ast.clear();
+    ast.setKeepSpans(incremental);
+    ast.reserve(nodes);
+    uint32_t first = Ast::npos;
+    uint32_t last = Ast::npos;
+    uint32_t lastStart = static_cast<uint32_t>(bodyStart);
+    for (size_t i = 0; i < workers.size(); ++i) {
+        uint32_t base = ast.append(workers[i]->ast);
+        const OpenList& list = workers[i]->openLists[0];
+        if (list.first == Ast::npos) continue;
+        if (incremental) {
+            ast.span(base + list.first).offset += static_cast<uint32_t>(slices[i].first) - lastStart;
+        }
+        if (last == Ast::npos) {
+            first = base + list.first;
+        } else {
+            ast.node(last).next = base + list.first;
+        }
+        last = base + list.last;
+        lastStart = list.lastStart;
+    }
+    ast.setRoot(ast.add(AstKind::PROGRAM, first, Ast::npos));
+    if (incremental) {
+        ast.span(ast.getRoot()) = {0, static_cast<uint32_t>(count - 1), 0};
+    }
+    
+    // Where a sequential parse leaves off
+    lexer->seekToken(count);
+    tokensRead = static_cast<uint32_t>(count);
+    tokenIndex = static_cast<uint32_t>(count - 1);
+    currentToken = tokens.token(count - 1);
+    syntaxErrors = 0;
+    programNode = ast.getRoot();
+    fullParseNodes = ast.size();
+    pendingFirst = pendingEnd = 0;
+    accepted = true;
+    return true;
+}
+
+// Parse the statements in tokens [first, end) on a worker, from `stmts`
+// with the declaration state the sequential parse has there. Returns false
+// on a syntax error.
+bool Parser::parseSlice(size_t first, size_t end, bool declaring) {
+    buildAst = true;
+    ast.setKeepSpans(incremental);
+    openLists.assign(1, {Ast::npos, Ast::npos, static_cast<uint32_t>(first)});
+    isInDeclaration = declaring;
+    sliceEnd = end;
+    resumed = false;
+    
+    parseStack.assign(1, stmtsId);
+    tokensRead = static_cast<uint32_t>(first);
+    advance();
+    return runParseLoop() && resumed;
+}
+
+// Run the parse loop on the stack as set up. A reparse stops when its
+// statement list ends (the stack is down to listFloor, or below it if
+// recovery cut into the list's context) or at a statement where old ones
+// can be reused.
+bool Parser::runParseLoop() {
     // Main parsing loop
-    while (!parseStack.empty()) {
-        std::string top = parseStack.top();
-        parseStack.pop();
+    while (parseStack.size() > listFloor) {
+        uint16_t top = parseStack.back();
+        parseStack.pop_back();
+        
+        // Semantic actions consume no input (and are skipped once an
+        // error has dropped the tree)
+        if (top & actionBit) {
+            if (buildAst) {
+                runAction(top & ~actionBit);
+            }
+            continue;
+        }
+        
+        uint16_t terminal = terminalOf(currentToken);
         
-        // If end of stack and end of input, parsing successful
-        if (top == "$" && currentToken.type == TokenType::END_OF_FILE) {
-            writeParsingStage("$", "$", "", "Accepted");
+        // If end of stack and end of input, parsing is done
+        if (top == endMarkerId && currentToken.type == TokenType::END_OF_FILE) {
+            if (syntaxErrors > 0) {
+                TRACE_STAGE("$", "$", "", "Finished with " + std::to_string(syntaxErrors) + " error(s)");
+                RECORD_STEP(FINISHED, static_cast<uint16_t>(std::min<size_t>(syntaxErrors, UINT16_MAX)));
+                return false;
+            }
+            TRACE_STAGE("$", "$", "", "Accepted");
+            RECORD_STEP(ACCEPT, 0);
             return true;
         }
         
         // For terminals, match exactly what's on the stack
         if (!isNonTerminal(top)) {
-            std::string tokenStr = tokenToString(currentToken);
-            
             // Track when we enter a declaration
-            if (top == "int" || top == "float") {
+            if (top == intId || top == floatId) {
                 isInDeclaration = true;
             }
             // Track when we exit a declaration
-            else if (top == ";") {
+            else if (top == semicolonId) {
                 isInDeclaration = false;
             }
             
-            if (top == tokenStr) {
+            if (top == terminal) {
                 // If this is an identifier token, handle it appropriately
                 if (currentToken.type == TokenType::IDENTIFIER) {
                     handleIdentifier(currentToken);
                 }
+                if (buildAst) {
+                    pushTokenValue(currentToken);
+                }
                 
-                writeParsingStage(stackToString(parseStack), tokenStr, "", "Match: " + top);
+                // Not recorded in a binary trace: readers replay it from the token types
+                TRACE_STAGE(stackToString(), tokenToString(currentToken), "",
+                                  "Match: " + symbolName(top));
                 advance();
+                if (quietTokens > 0) {
+                    quietTokens--;
+                }
                 continue;
             } else {
                 // Terminal mismatch
-                std::string errorMsg = "Syntax error: expected '" + top + "', found '" + 
-                                     currentToken.lexeme + "'";
-                if (errorHandler) {
-                    errorHandler->syntaxError(errorMsg, currentToken.line, currentToken.column);
-                }
-                
-                writeParsingStage(stackToString(parseStack), tokenStr, "", 
+                std::string errorMsg = "Syntax error: expected '" + symbolName(top) + "', found '" + 
+                                     std::string(currentToken.lexeme) + "'";
+                parseStack.push_back(top);
+                TRACE_STAGE(stackToString(), tokenToString(currentToken), "", 
                                 "ERROR: Terminal mismatch");
-                panic();  // Error recovery
-                return false;
+                RECORD_STEP(MISMATCH, top);
+                if (!reportSyntaxError(errorMsg) || !recover()) {
+                    return false;
+                }
+                continue;
             }
         }
         
+        // Only a reparse or a parallel parse's worker has `stmts` at its
+        // floor: this is a statement boundary of its list
+        if (parseStack.size() == listFloor && top == stmtsId && (tokenIndex == sliceEnd || resumeHere())) {
+            resumed = true;
+            break;
+        }
+        
         // If non-terminal, look up in parse table
-        std::string terminal = tokenToString(currentToken);
-        std::cout << "DEBUG: Looking up [" << top << ", " << terminal << "] in parse table" << std::endl;
+        PARSER_DEBUG("Looking up [" << symbolName(top) << ", " << tokenToString(currentToken) << "] in parse table");
         
         // Look up production in parse table
-        auto ntIt = parseTable.find(top);
-        if (ntIt != parseTable.end() && ntIt->second.find(terminal) != ntIt->second.end()) {
-            int prodIndex = ntIt->second[terminal];
-            const auto& production = grammar->getProductions()[prodIndex];
-            
-            std::cout << "DEBUG: Found production #" << prodIndex << " in parse table" << std::endl;
+        int prodIndex = -1;
+        if (terminal != noSymbol) {
+            prodIndex = parseTable[top * terminalCount + (terminal & ~terminalBit)];
+        }
+        if (prodIndex >= 0) {
+            PARSER_DEBUG("Found production #" << prodIndex << " in parse table");
             
-            // Build production string for logging
-            std::string prodString = top + " → ";
-            for (const auto& symbol : production.rightSide) {
-                prodString += symbol.name + " ";
-            }
+            // Push production RHS onto stack (already reversed, without ε)
+            size_t first = pushStart[prodIndex];
+            size_t count = pushStart[prodIndex + 1] - first;
+            size_t depth = parseStack.size();
+            parseStack.resize(depth + count);
+            std::memcpy(parseStack.data() + depth, pushSymbols.data() + first, count * sizeof(uint16_t));
             
-            // Push production RHS onto stack in reverse order
-            for (int i = production.rightSide.size() - 1; i >= 0; --i) {
-                if (production.rightSide[i].name != "ε") {  // Don't push epsilon
-                    parseStack.push(production.rightSide[i].name);
-                }
-            }
-            
-            writeParsingStage(stackToString(parseStack), terminal, prodString, "Expand non-terminal");
+            // Not recorded in a binary trace either
+            TRACE_STAGE(stackToString(), tokenToString(currentToken), productionToString(prodIndex),
+                        "Expand non-terminal");
         } else {
             // Syntax error - no matching production
-            std::string errorMsg = "Syntax error: unexpected token '" + currentToken.lexeme + 
-                                 "' for non-terminal '" + top + "'";
-            if (errorHandler) {
-                errorHandler->syntaxError(errorMsg, currentToken.line, currentToken.column);
-            }
-            
-            writeParsingStage(stackToString(parseStack), tokenToString(currentToken), "", 
+            std::string errorMsg = "Syntax error: unexpected token '" + std::string(currentToken.lexeme) + 
+                                 "' for non-terminal '" + symbolName(top) + "'";
+            parseStack.push_back(top);
+            TRACE_STAGE(stackToString(), tokenToString(currentToken), "", 
                             "ERROR: No matching production");
-            panic();  // Error recovery
-            return false;
+            RECORD_STEP(NO_PRODUCTION, top);
+            if (!reportSyntaxError(errorMsg) || !recover()) {
+                return false;
+            }
         }
     }
     
+    if (regionParse || sliceParse) {
+        return true;
+    }
+    
     // If we reach here, there's an error
     if (currentToken.type != TokenType::END_OF_FILE) {
-        std::string errorMsg = "Syntax error: unexpected token '" + currentToken.lexeme + 
+        std::string errorMsg = "Syntax error: unexpected token '" + std::string(currentToken.lexeme) + 
                              "' after end of input";
         if (errorHandler) {
-            errorHandler->syntaxError(errorMsg, currentToken.line, currentToken.column);
+            errorHandler->syntaxError(errorMsg, currentToken.offset);
         }
-        writeParsingStage("", tokenToString(currentToken), "", "ERROR: Unexpected token after input");
+        TRACE_STAGE("", tokenToString(currentToken), "", "ERROR: Unexpected token after input");
+        RECORD_STEP(TRAILING, 0);
+        ast.clear();
         return false;
     }
     
@@ -178,8 +497,12 @@ bool Parser::parse() {
 
 // Generate first and follow sets
 void Parser::generateFirstAndFollowSets() {
-    grammar->computeFirstSets();
-    grammar->computeFollowSets();
+    // The built-in grammar's sets were computed at compile time, and a
+    // cached grammar's by an earlier run
+    if (!grammar->isBuiltin() && !grammar->isCompiled()) {
+        grammar->computeFirstSets();
+        grammar->computeFollowSets();
+    }
     writeFirstAndFollowSetsToFile();
 }
 
@@ -187,53 +510,156 @@ void Parser::generateFirstAndFollowSets() {
 void Parser::generateParseTable() {
     initParseTable();
     
+    // The built-in grammar's table was computed at compile time
+    if (grammar->isBuiltin()) {
+        const int16_t* table = &BuiltinGrammar::tables.parseTable[0][0];
+        std::copy(table, table + parseTable.size(), parseTable.begin());
+        writeParseTableToFile();
+        return;
+    }
+    if (const int16_t* table = grammar->getCompiledTable()) {
+        std::copy(table, table + parseTable.size(), parseTable.begin());
+        writeParseTableToFile();
+        return;
+    }
+    
+    // FIRST and FOLLOW must be computed first
+    if (!grammar->hasSets()) {
+        writeParseTableToFile();
+        return;
+    }
+    
     // For each production
+    bool conflicts = false;
+    size_t words = grammar->getSetWords();
+    std::vector<uint64_t> firstOfRHS(words);
     const auto& productions = grammar->getProductions();
     for (size_t i = 0; i < productions.size(); ++i) {
-        const auto& prod = productions[i];
-        const auto& lhs = prod.leftSide;
-        const auto& rhs = prod.rightSide;
+        uint16_t lhsId = symbolId(productions[i].leftSide.name);
         
-        // Get FIRST of the right side
-        std::set<GrammarSymbol> firstOfRHS = grammar->getFirstSetOfSequence(rhs);
+        // FIRST of the right side, from the grammar's bitsets (terminal j
+        // is bit j, and bit 0 is ε). The push sequence is the right side
+        // reversed, so it is read from its end.
+        std::fill(firstOfRHS.begin(), firstOfRHS.end(), 0);
+        bool nullable = true;
+        for (uint32_t k = pushStart[i + 1]; k > pushStart[i] && nullable; --k) {
+            uint16_t symbol = pushSymbols[k - 1];
+            if (!isNonTerminal(symbol)) {
+                size_t terminal = symbol & ~terminalBit;
+                firstOfRHS[terminal / 64] |= uint64_t(1) << (terminal % 64);
+                nullable = false;
+                break;
+            }
+            const uint64_t* first = grammar->getFirstBits(symbol);
+            for (size_t w = 0; w < words; ++w) {
+                firstOfRHS[w] |= first[w];
+            }
+            nullable = first[0] & 1;
+        }
+        firstOfRHS[0] &= ~uint64_t(1);
         
         // For each terminal in FIRST(RHS), add production to table
-        for (const auto& terminal : firstOfRHS) {
-            if (terminal.name == "ε") {
-                // For epsilon, use FOLLOW(LHS)
-                const auto& followLHS = grammar->getFollowSet(lhs);
-                for (const auto& followTerm : followLHS) {
-                    addToParseTable(lhs.name, followTerm.name, i);
+        for (size_t terminal = 0; terminal < terminalCount; ++terminal) {
+            if (firstOfRHS[terminal / 64] >> (terminal % 64) & 1) {
+                conflicts |= !addToParseTable(lhsId, static_cast<uint16_t>(terminalBit | terminal), i);
+            }
+        }
+        
+        // For ε, use FOLLOW(LHS)
+        if (nullable) {
+            const uint64_t* follow = grammar->getFollowBits(lhsId);
+            for (size_t terminal = 0; terminal < terminalCount; ++terminal) {
+                if (follow[terminal / 64] >> (terminal % 64) & 1) {
+                    conflicts |= !addToParseTable(lhsId, static_cast<uint16_t>(terminalBit | terminal), i);
                 }
-            } else {
-                // For terminal, add to table
-                addToParseTable(lhs.name, terminal.name, i);
             }
         }
     }
     
+    // A grammar loaded from a file is cached for later runs, unless it
+    // has conflicts to report again
+    if (!conflicts) {
+        grammar->saveCompiledTable(parseTable);
+    }
     writeParseTableToFile();
 }
 
-// Initialize parse table
+// Number the grammar symbols and create an empty parse table
 void Parser::initParseTable() {
-    parseTable.clear();
+    const auto& nonTerminals = grammar->getNonTerminals();
+    const auto& terminals = grammar->getTerminals();
+    nonTerminalCount = nonTerminals.size();
+    terminalCount = terminals.size();
+    
+    nonTerminalNames.clear();
+    terminalNames.clear();
+    symbolIds.clear();
+    for (const auto& nt : nonTerminals) {
+        symbolIds.emplace(nt.name, static_cast<uint16_t>(nonTerminalNames.size()));
+        nonTerminalNames.push_back(nt.name);
+    }
+    for (const auto& term : terminals) {
+        symbolIds.emplace(term.name, static_cast<uint16_t>(terminalBit | terminalNames.size()));
+        terminalNames.push_back(term.name);
+    }
     
     // Initialize with empty entries
-    for (const auto& nt : grammar->getNonTerminals()) {
-        std::map<std::string, int> row;
-        parseTable[nt.name] = row;
+    parseTable.assign(nonTerminalCount * terminalCount, -1);
+    
+    // Push sequences: right sides reversed, without ε. The built-in
+    // grammar's were built at compile time and include its semantic actions.
+    if (grammar->isBuiltin()) {
+        const auto& tables = BuiltinGrammar::tables;
+        pushSymbols.assign(std::begin(tables.pushSymbols), std::end(tables.pushSymbols));
+        pushStart.assign(std::begin(tables.pushStart), std::end(tables.pushStart));
+    } else {
+        pushSymbols.clear();
+        pushStart.assign(1, 0);
+        for (const auto& prod : grammar->getProductions()) {
+            for (auto it = prod.rightSide.rbegin(); it != prod.rightSide.rend(); ++it) {
+                if (it->name != "ε") {
+                    pushSymbols.push_back(symbolId(it->name));
+                }
+            }
+            pushStart.push_back(static_cast<uint32_t>(pushSymbols.size()));
+        }
     }
+    parseStack.reserve(64);
+    
+    endMarkerId = symbolId("$");
+    intId = symbolId("int");
+    floatId = symbolId("float");
+    semicolonId = symbolId(";");
+    stmtsId = symbolId("stmts");
+    
+    // FOLLOW set of every non-terminal as one flag per terminal, for error recovery
+    followTable.assign(nonTerminalCount * terminalCount, 0);
+    for (size_t nt = 0; nt < nonTerminalCount && grammar->hasSets(); ++nt) {
+        const uint64_t* follow = grammar->getFollowBits(nt);
+        for (size_t terminal = 0; terminal < terminalCount; ++terminal) {
+            followTable[nt * terminalCount + terminal] = follow[terminal / 64] >> (terminal % 64) & 1;
+        }
+    }
+    
+    // Each token type matches the terminal of the same name; the end of
+    // input matches the end marker
+    for (size_t t = 0; t < tokenTypeCount; ++t) {
+        uint16_t id = symbolId(tokenNames[t]);
+        tokenTerminals[t] = isNonTerminal(id) ? noSymbol : id;
+    }
+    tokenTerminals[static_cast<size_t>(TokenType::END_OF_FILE)] = endMarkerId;
 }
 
 // Add entry to parse table
-void Parser::addToParseTable(const std::string& nonTerminal, const std::string& terminal, int productionIndex) {
-    auto& row = parseTable[nonTerminal];
+bool Parser::addToParseTable(uint16_t nonTerminal, uint16_t terminal, int productionIndex) {
+    int16_t& entry = parseTable[nonTerminal * terminalCount + (terminal & ~terminalBit)];
     
     // Check for conflicts (overwriting existing entry)
-    if (row.find(terminal) != row.end()) {
+    bool conflict = entry >= 0;
+    if (conflict) {
         // Parse table conflict - not LL(1)
-        std::string errorMsg = "Parse table conflict for [" + nonTerminal + ", " + terminal + "]";
+        std::string errorMsg = "Parse table conflict for [" + symbolName(nonTerminal) + ", " +
+                               symbolName(terminal) + "]";
         std::cerr << "Warning: " << errorMsg << std::endl;
         
         if (errorHandler) {
@@ -242,66 +668,320 @@ void Parser::addToParseTable(const std::string& nonTerminal, const std::string&
     }
     
     // Add entry to table
-    row[terminal] = productionIndex;
+    entry = static_cast<int16_t>(productionIndex);
+    return !conflict;
 }
 
-// Check if a symbol is a non-terminal
-bool Parser::isNonTerminal(const std::string& symbol) {
-    for (const auto& nt : grammar->getNonTerminals()) {
-        if (nt.name == symbol) {
-            return true;
+// Get the id of a symbol name
+uint16_t Parser::symbolId(const std::string& name) const {
+    auto it = symbolIds.find(name);
+    return it != symbolIds.end() ? it->second : noSymbol;
+}
+
+// Get the name of a symbol id
+const std::string& Parser::symbolName(uint16_t symbol) const {
+    if (isNonTerminal(symbol)) {
+        return nonTerminalNames[symbol];
+    }
+    return terminalNames[symbol & ~terminalBit];
+}
+
+// Value a matched terminal contributes to the tree
+void Parser::pushTokenValue(const Token& token) {
+    switch (token.type) {
+        case TokenType::IDENTIFIER:
+            values.push_back(ast.add(AstKind::IDENTIFIER, token.value, static_cast<uint32_t>(token.offset)));
+            setSpan(values.back(), tokenIndex, tokenIndex + 1);
+            break;
+        case TokenType::INTEGER_LITERAL:
+        case TokenType::FLOAT_LITERAL:
+            values.push_back(ast.add(AstKind::CONSTANT, token.value, static_cast<uint32_t>(token.offset)));
+            setSpan(values.back(), tokenIndex, tokenIndex + 1);
+            break;
+        case TokenType::INT:
+        case TokenType::FLOAT:
+        case TokenType::PLUS:
+        case TokenType::MINUS:
+        case TokenType::MULTIPLY:
+        case TokenType::DIVIDE:
+        case TokenType::INCREMENT:
+        case TokenType::DECREMENT:
+        case TokenType::LESS_THAN:
+        case TokenType::GREATER_THAN:
+            values.push_back(static_cast<uint32_t>(token.type));
+            break;
+        default:
+            // Punctuation and the remaining keywords carry no value
+            break;
+    }
+}
+
+// Set the span of a node just added (when spans are kept). Its depth is
+// the number of statement lists open, counting those around a reparse.
+// The offset holds the absolute first token until its statement is added.
+void Parser::setSpan(uint32_t node, uint32_t firstToken, uint32_t endToken) {
+    if (ast.hasSpans()) {
+        ast.span(node) = {firstToken, endToken - firstToken, regionDepth + static_cast<uint32_t>(openLists.size())};
+    }
+}
+
+// Make the spans of an expression relative to the first token of its
+// statement. Operator chains are left-deep, so the loop follows the left
+// operand.
+void Parser::anchorSpans(uint32_t node, uint32_t start) {
+    while (node != Ast::npos) {
+        ast.span(node).offset -= start;
+        const AstNode& expr = ast.node(node);
+        if (expr.kind != AstKind::COND && expr.kind != AstKind::BINARY_EXPR) {
+            return;
         }
+        anchorSpans(expr.second, start);
+        node = expr.first;
     }
-    return false;
 }
 
-// Panic mode error recovery
-void Parser::panic() {
-    // Simple implementation: skip tokens until a semicolon is found
-    writeParsingStage(stackToString(parseStack), currentToken.getTypeAsString(), "", "Panic mode: skip until ';'");
-    
-    while (currentToken.type != TokenType::END_OF_FILE && 
-           currentToken.type != TokenType::SEMICOLON) {
-        advance();
+// Add a statement starting at token `start` to the innermost open block.
+// It ends at the current token: its action runs right after its last
+// token is matched.
+void Parser::appendStatement(uint32_t node, uint32_t start) {
+    OpenList& list = openLists.back();
+    if (list.last == Ast::npos) {
+        list.first = node;
+    } else {
+        ast.node(list.last).next = node;
     }
+    list.last = node;
     
-    // Skip the semicolon
-    if (currentToken.type == TokenType::SEMICOLON) {
-        advance();
+    if (ast.hasSpans()) {
+        ast.span(node) = {start - list.lastStart, tokenIndex - start,
+                          regionDepth + static_cast<uint32_t>(openLists.size())};
+        const AstNode& statement = ast.node(node);
+        anchorSpans(statement.first, start);
+        if (statement.kind != AstKind::WHILE) {
+            anchorSpans(statement.second, start);
+        }
     }
+    list.lastStart = start;
+}
+
+// Run a semantic action of the built-in grammar
+void Parser::runAction(uint16_t action) {
+    using namespace BuiltinGrammar;
     
-    // Clear stack and restart from a safe point
-    while (!parseStack.empty()) parseStack.pop();
-    parseStack.push("$");
+    auto pop = [this]() {
+        uint32_t value = values.back();
+        values.pop_back();
+        return value;
+    };
     
-    // Find a suitable recovery symbol based on grammar
-    const auto& nonTerminals = grammar->getNonTerminals();
-    for (const auto& nt : nonTerminals) {
-        if (nt.name == "stmt" || nt.name == "stmts" || 
-            nt.name == "decl" || nt.name == "expr_stmt") {
-            parseStack.push(nt.name);
+    // First token of an expression, to derive spans from (only read when
+    // spans are kept)
+    auto firstToken = [this](uint32_t node) {
+        return ast.hasSpans() ? ast.span(node).offset : 0;
+    };
+    
+    switch (action) {
+        case BEGIN_LIST:
+            openLists.push_back({Ast::npos, Ast::npos, tokenIndex});
+            break;
+        case END_PROGRAM: {
+            uint32_t body = openLists.back().first;
+            openLists.pop_back();
+            values.clear();  // The 'int' of 'int main()'
+            ast.setRoot(ast.add(AstKind::PROGRAM, body, Ast::npos));
+            setSpan(ast.getRoot(), 0, tokenIndex);
+            break;
+        }
+        case DECLARE: {
+            uint32_t init = pop();
+            uint32_t id = pop();
+            TokenType type = static_cast<TokenType>(values.back());  // Shared by the whole list
+            uint32_t node = ast.add(AstKind::DECL, id, init, type);
+            
+            // Every Decl of a declaration spans the whole of it, from the type
+            // before the first name; END_DECL sets the length
+            if (openDecl == Ast::npos) {
+                openDecl = node;
+                appendStatement(node, firstToken(id) - 1);
+            } else {
+                appendStatement(node, openLists.back().lastStart);
+            }
+            break;
+        }
+        case END_DECL:
+            values.pop_back();
+            if (ast.hasSpans()) {
+                uint32_t length = tokenIndex - openLists.back().lastStart;
+                for (uint32_t node = openDecl; node != Ast::npos; node = ast.node(node).next) {
+                    ast.span(node).length = length;
+                }
+            }
+            openDecl = Ast::npos;
+            break;
+        case NO_INIT:
+            values.push_back(Ast::npos);
+            break;
+        case ASSIGN_STMT: {
+            uint32_t expr = pop();
+            uint32_t id = pop();
+            uint32_t node = ast.add(AstKind::ASSIGN, id, expr);
+            appendStatement(node, firstToken(id));
             break;
         }
+        case PREFIX:
+        case POSTFIX: {
+            bool prefix = (action == PREFIX);
+            uint32_t first = pop();
+            uint32_t second = pop();
+            uint32_t id = prefix ? first : second;
+            TokenType op = static_cast<TokenType>(prefix ? second : first);
+            uint32_t node = ast.add(AstKind::UNARY, id, Ast::npos, op);
+            ast.node(node).prefix = prefix;
+            appendStatement(node, firstToken(id) - (prefix ? 1 : 0));
+            break;
+        }
+        case WHILE_LOOP: {
+            uint32_t body = openLists.back().first;
+            openLists.pop_back();
+            uint32_t cond = pop();
+            uint32_t node = ast.add(AstKind::WHILE, cond, body);
+            appendStatement(node, firstToken(cond) - 2);  // "while ("
+            break;
+        }
+        case CONDITION:
+        case BINARY: {
+            uint32_t right = pop();
+            TokenType op = static_cast<TokenType>(pop());
+            uint32_t left = pop();
+            values.push_back(ast.add(action == CONDITION ? AstKind::COND : AstKind::BINARY_EXPR, left, right, op));
+            if (ast.hasSpans()) {
+                setSpan(values.back(), ast.span(left).offset, ast.span(right).offset + ast.span(right).length);
+            }
+            break;
+        }
+        case PARENS:
+            // A statement or a While body is found from the spans of its
+            // expressions, so they count the parentheses too
+            if (ast.hasSpans()) {
+                AstSpan& span = ast.span(values.back());
+                span.offset--;
+                span.length = tokenIndex - span.offset;
+            }
+            break;
     }
-    
-    writeParsingStage(stackToString(parseStack), currentToken.getTypeAsString(), "", "Resumed parsing");
 }
 
-// Convert stack to string
-std::string Parser::stackToString(std::stack<std::string> s) {
-    if (s.empty()) return "ε";
+// Report a syntax error unless it is a cascade of the previous one.
+// Returns false once the error budget is used up.
+bool Parser::reportSyntaxError(const std::string& message) {
+    // The input of a worker is parsed again sequentially
+    if (sliceParse) {
+        return false;
+    }
     
-    std::vector<std::string> elements;
-    while (!s.empty()) {
-        elements.push_back(s.top());
-        s.pop();
+    // The partial tree is dropped (a reparse keeps the old one)
+    if (!regionParse) {
+        ast.clear();
     }
+    buildAst = false;
     
-    std::reverse(elements.begin(), elements.end());
+    // Errors right after a recovery are usually caused by it
+    if (quietTokens > 0) {
+        return true;
+    }
+    
+    syntaxErrors++;
+    syntaxError(message, currentToken.offset);
+    if (errorBudget > 0 && syntaxErrors >= errorBudget) {
+        syntaxError("Too many syntax errors (" + std::to_string(syntaxErrors) + "); parsing stopped",
+                    currentToken.offset);
+        TRACE_STAGE(stackToString(), tokenToString(currentToken), "", "Error budget used up");
+        RECORD_STEP(BUDGET, 0);
+        return false;
+    }
+    return true;
+}
+
+// Report a syntax error. A reparse holds its errors until it knows which
+// attempt's errors stand.
+void Parser::syntaxError(const std::string& message, size_t offset) {
+    if (regionParse) {
+        regionErrors.push_back({message, offset, sliceNames.size()});
+    } else if (errorHandler) {
+        errorHandler->syntaxError(message, offset);
+    }
+}
+
+// Error recovery: synchronize the stack and the input on a token that a
+// symbol on the stack can continue with. The symbol on top is the one that
+// failed. Returns false if the input ran out first.
+bool Parser::recover() {
+    size_t skipped = 0;
+    
+    for (;;) {
+        uint16_t terminal = terminalOf(currentToken);
+        
+        // Walk down the stack for a symbol that accepts the token: a
+        // terminal equal to it, a non-terminal with a production for it, or
+        // a non-terminal it can follow (which is then considered complete)
+        if (terminal != noSymbol) {
+            size_t column = terminal & ~terminalBit;
+            for (size_t i = parseStack.size(); i-- > 0;) {
+                uint16_t symbol = parseStack[i];
+                if (symbol & actionBit) continue;
+                
+                size_t keep = SIZE_MAX;  // Stack size to resume with
+                if (!isNonTerminal(symbol)) {
+                    if (symbol == terminal) keep = i + 1;
+                } else if (parseTable[symbol * terminalCount + column] >= 0) {
+                    keep = i + 1;
+                } else if (followTable[symbol * terminalCount + column]) {
+                    keep = i;
+                }
+                
+                if (keep != SIZE_MAX) {
+                    parseStack.resize(keep);
+                    quietTokens = recoveryQuietTokens;
+                    TRACE_STAGE(stackToString(), tokenToString(currentToken), "",
+                                      "Resumed parsing after skipping " + std::to_string(skipped) + " token(s)");
+                    RECORD_STEP(RESUME, 0);
+                    return true;
+                }
+            }
+        }
+        
+        if (currentToken.type == TokenType::END_OF_FILE) {
+            TRACE_STAGE(stackToString(), tokenToString(currentToken), "", "Recovery reached end of input");
+            RECORD_STEP(RECOVERY_EOF, 0);
+            return false;
+        }
+        
+        // Nothing on the stack can use the token: skip it. A ';' nobody
+        // expects ends the broken statement, so parsing restarts at the
+        // innermost statement list.
+        bool statementEnd = (currentToken.type == TokenType::SEMICOLON);
+        advance();
+        skipped++;
+        if (statementEnd) {
+            isInDeclaration = false;
+            for (size_t i = parseStack.size(); i-- > 0;) {
+                if (parseStack[i] == stmtsId) {
+                    parseStack.resize(i + 1);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Convert the parse stack to string
+std::string Parser::stackToString() const {
+    if (parseStack.empty()) return "ε";
     
     std::stringstream ss;
-    for (const auto& elem : elements) {
-        ss << elem << " ";
+    for (uint16_t symbol : parseStack) {
+        if (symbol & actionBit) continue;  // Actions are not grammar symbols
+        ss << symbolName(symbol) << " ";
     }
     
     std::string result = ss.str();
@@ -312,6 +992,33 @@ std::string Parser::stackToString(std::stack<std::string> s) {
     return result;
 }
 
+// Production as "lhs → rhs " for the parsing stages table
+std::string Parser::productionToString(int index) const {
+    const auto& production = grammar->getProductions()[index];
+    std::string result = production.leftSide.name + " → ";
+    for (const auto& symbol : production.rightSide) {
+        result += symbol.name + " ";
+    }
+    return result;
+}
+
+// Symbols and tables of the grammar, for the header of a binary trace
+TraceGrammar Parser::traceGrammar() const {
+    TraceGrammar traced;
+    traced.terminalNames = terminalNames;
+    traced.nonTerminalNames = nonTerminalNames;
+    for (size_t p = 0; p + 1 < pushStart.size(); ++p) {
+        traced.productionTexts.push_back(productionToString(static_cast<int>(p)));
+    }
+    traced.pushStart = pushStart;
+    traced.pushSymbols = pushSymbols;
+    traced.parseTable = parseTable;
+    traced.tokenTerminals.assign(tokenTerminals.begin(), tokenTerminals.end());
+    traced.startSymbol = symbolId(grammar->getStartSymbol().name);
+    traced.endMarker = endMarkerId;
+    return traced;
+}
+
 // Write parsing stage to file
 void Parser::writeParsingStage(const std::string& stackContent, const std::string& input,
                              const std::string& production, const std::string& action) {
@@ -358,18 +1065,24 @@ void Parser::writeFirstAndFollowSetsToFile() {
 void Parser::writeParseTableToFile() {
     if (!parseTableFile.is_open()) return;
     
-    // Get all terminals
-    std::set<std::string> terminals;
-    for (const auto& term : grammar->getTerminals()) {
-        if (term.name != "ε") {  // Skip epsilon
-            terminals.insert(term.name);
+    // Get all terminals (columns), in name order
+    std::map<std::string, size_t> terminals;
+    for (size_t column = 0; column < terminalNames.size(); ++column) {
+        if (terminalNames[column] != "ε") {  // Skip epsilon
+            terminals.emplace(terminalNames[column], column);
         }
     }
     
+    // Rows, in name order
+    std::map<std::string, size_t> rows;
+    for (size_t row = 0; row < nonTerminalNames.size(); ++row) {
+        rows.emplace(nonTerminalNames[row], row);
+    }
+    
     // Write header
     parseTableFile << "| Non-Terminal |";
     for (const auto& term : terminals) {
-        parseTableFile << " " << term << " |";
+        parseTableFile << " " << term.first << " |";
     }
     parseTableFile << "\n|";
     
@@ -381,14 +1094,13 @@ void Parser::writeParseTableToFile() {
     parseTableFile << "\n";
     
     // Write table content
-    for (const auto& ntEntry : parseTable) {
-        parseTableFile << "| " << ntEntry.first << " |";
+    for (const auto& row : rows) {
+        parseTableFile << "| " << row.first << " |";
         
         for (const auto& term : terminals) {
             parseTableFile << " ";
-            auto it = ntEntry.second.find(term);
-            if (it != ntEntry.second.end()) {
-                int prodIndex = it->second;
+            int prodIndex = parseTable[row.second * terminalCount + term.second];
+            if (prodIndex >= 0) {
                 
                 // Write production number
                 parseTableFile << prodIndex << " ";
@@ -402,42 +1114,398 @@ void Parser::writeParseTableToFile() {
 }
 
 // Get current token
-Token Parser::getCurrentToken() const {
+const Token& Parser::getCurrentToken() const {
     return currentToken;
 }
 
+// Get the syntax tree
+const Ast& Parser::getAst() const {
+    return ast;
+}
+
+// Set the trace level
+void Parser::setTraceLevel(TraceLevel level) {
+    traceLevel = level;
+}
+
+// Record a binary trace of every parse
+void Parser::setTraceRecorder(std::shared_ptr<ParseTraceRecorder> traceRecorder) {
+    recorder = traceRecorder;
+}
+
+// Name of a token type in the parse table
+const char* Parser::tokenName(TokenType type) {
+    return tokenNames[static_cast<size_t>(type)];
+}
+
+// Set the error budget
+void Parser::setErrorBudget(size_t budget) {
+    errorBudget = budget;
+}
+
+// Get the number of syntax errors reported by the last parse
+size_t Parser::getSyntaxErrorCount() const {
+    return syntaxErrors;
+}
+
+// Set the number of parsing threads
+void Parser::setThreadCount(unsigned count, size_t minTokens) {
+    threadCount = count > 0 ? count : 1;
+    parallelMinTokens = minTokens;
+}
+
+// Turn incremental mode on or off
+void Parser::setIncremental(bool enabled) {
+    incremental = enabled;
+    programNode = Ast::npos;
+    pendingFirst = pendingEnd = 0;
+}
+
+// Parse the whole input again, from a clean symbol table and without the
+// errors of the last parse
+bool Parser::parseInFull() {
+    lastReparse = ReparseRegion();
+    lastReparse.full = true;
+    lastReparse.tokens = lexer->getTokens().size();
+    symbolTable->clear();
+    if (errorHandler) {
+        errorHandler->clear(ErrorType::SYNTAX_ERROR);
+        errorHandler->clear(ErrorType::SEMANTIC_ERROR);
+    }
+    lexer->seekToken(0);
+    return parse();
+}
+
+// First token of a Program or While body (after "int main ( ) {" or
+// "while ( cond ) {") and the index of the '}' closing it, for an owner
+// starting at token ownerStart
+void Parser::bodyTokens(uint32_t owner, size_t ownerStart, size_t& start, size_t& close) const {
+    const AstNode& node = ast.node(owner);
+    if (node.kind == AstKind::PROGRAM) {
+        start = ownerStart + 5;
+    } else {
+        start = ownerStart + ast.span(node.first).offset + ast.span(node.first).length + 2;
+    }
+    close = ownerStart + ast.span(owner).length - 1;
+}
+
+// At a statement boundary of the list being reparsed, past the damage:
+// whether an old statement of the list starts at the current token, in the
+// state it was parsed in. The stack is the one the old statement was
+// parsed on (the list's context and its `stmts`), so only its start needs
+// checking: its kind must also fit the token, or its span is not to be
+// trusted.
+bool Parser::resumeHere() {
+    if (tokenIndex < resumeFrom) {
+        return false;
+    }
+    while (resumeCandidate != Ast::npos && resumePosition < tokenIndex) {
+        resumeCandidate = ast.node(resumeCandidate).next;
+        if (resumeCandidate != Ast::npos) {
+            resumePosition += ast.span(resumeCandidate).offset;
+        }
+    }
+    if (resumeCandidate == Ast::npos || resumePosition != tokenIndex ||
+        ast.span(resumeCandidate).depth != regionDepth + 1) {
+        return false;
+    }
+    
+    const AstNode& statement = ast.node(resumeCandidate);
+    switch (statement.kind) {
+        case AstKind::WHILE:
+            return currentToken.type == TokenType::WHILE;
+        case AstKind::DECL:
+            return statement.op() == currentToken.type;
+        case AstKind::ASSIGN:
+            return currentToken.type == TokenType::IDENTIFIER;
+        case AstKind::UNARY:
+            return currentToken.type == (statement.prefix ? statement.op() : TokenType::IDENTIFIER);
+        default:
+            return false;
+    }
+}
+
+// Parse the statements of a region's block from its start until an old
+// statement from region.after on can be reused or the body ends. Returns
+// false if the new statements do not fit in the body: it ended at another
+// '}', recovery cut into the stack below the list, or parsing stopped
+// early. Otherwise they replace the old ones in the tree (after a syntax
+// error there are none, and the caller parses these tokens again later).
+bool Parser::parseRegion(const Region& region) {
+    using namespace BuiltinGrammar;
+    
+    regionParse = true;
+    regionDepth = ast.span(region.owner).depth;
+    resumeCandidate = region.after;
+    resumePosition = region.afterStart;
+    resumed = false;
+    buildAst = true;
+    values.clear();
+    openLists.assign(1, {Ast::npos, Ast::npos, static_cast<uint32_t>(region.listStart)});
+    openDecl = Ast::npos;
+    syntaxErrors = 0;
+    quietTokens = 0;
+    regionErrors.clear();
+    sliceNames.clear();
+    
+    // The declaration state the parse loop has here: set by the last 'int'
+    // or 'float' before, cleared by a ';' (tokens before a region parsed
+    // without errors, so all of them were matched)
+    const TokenStore& tokens = lexer->getTokens();
+    isInDeclaration = false;
+    for (size_t i = region.start; i-- > 0;) {
+        TokenType type = tokens.type(i);
+        if (type == TokenType::SEMICOLON || type == TokenType::INT || type == TokenType::FLOAT) {
+            isInDeclaration = type != TokenType::SEMICOLON;
+            break;
+        }
+    }
+    
+    // The stack at a statement boundary of the list, as the full parse has
+    // it: the Program's end, then the end of each While around the list and
+    // the rest of the list that While is in. Recovery then finds what the
+    // full parse finds, and the loop stops at the list's floor.
+    parseStack.assign({endMarkerId, a(END_PROGRAM), t(RIGHT_BRACE)});
+    for (uint32_t depth = 0; depth < regionDepth; ++depth) {
+        parseStack.insert(parseStack.end(), {stmtsId, a(WHILE_LOOP), t(RIGHT_BRACE)});
+    }
+    listFloor = parseStack.size();
+    parseStack.push_back(stmtsId);
+    lexer->seekToken(region.start);
+    tokensRead = static_cast<uint32_t>(region.start);
+    advance();
+    bool finished = runParseLoop() && parseStack.size() == listFloor;
+    
+    regionParse = false;
+    regionDepth = 0;
+    listFloor = 0;
+    lastReparse = ReparseRegion();
+    lastReparse.firstToken = region.start;
+    lastReparse.tokens = tokenIndex - region.start;
+    
+    size_t bodyStart, close;
+    bodyTokens(region.owner, region.ownerStart, bodyStart, close);
+    if (!finished || (!resumed && tokenIndex != close)) {
+        return false;
+    }
+    
+    // Link the new statements in place of the old ones
+    OpenList list = buildAst ? openLists[0] : OpenList{Ast::npos, Ast::npos, static_cast<uint32_t>(region.listStart)};
+    uint32_t after = resumed ? resumeCandidate : Ast::npos;
+    if (after != Ast::npos) {
+        ast.span(after).offset = static_cast<uint32_t>(resumePosition - list.lastStart);
+    }
+    if (list.first == Ast::npos) {
+        list.first = after;
+    } else {
+        ast.node(list.last).next = after;
+    }
+    if (region.previous != Ast::npos) {
+        ast.node(region.previous).next = list.first;
+    } else if (ast.node(region.owner).kind == AstKind::PROGRAM) {
+        ast.node(region.owner).first = list.first;
+    } else {
+        ast.node(region.owner).second = list.first;
+    }
+    return true;
+}
+
+// Check the names of the whole input again after a reparse of tokens
+// [first, end), in the order a full parse checks them, from a clean symbol
+// table. Outside those tokens the input parsed without errors, so every
+// token there is matched and a walk over the types sees the names and the
+// declaration state the parse loop sees. Inside them the names the reparse
+// recorded stand, with its held syntax errors in between.
+void Parser::recheckNames(size_t first, size_t end, bool declaringAfter) {
+    const TokenStore& tokens = lexer->getTokens();
+    const uint8_t* types = tokens.typeArray().data();
+    bool declaring = false;
+    auto walk = [&](size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+            switch (static_cast<TokenType>(types[i])) {
+                case TokenType::INT:
+                case TokenType::FLOAT:
+                    declaring = true;
+                    break;
+                case TokenType::SEMICOLON:
+                    declaring = false;
+                    break;
+                case TokenType::IDENTIFIER:
+                    checkName(tokens.token(i), declaring);
+                    break;
+                default:
+                    break;
+            }
+        }
+    };
+    
+    symbolTable->clear();
+    walk(0, first);
+    auto held = regionErrors.begin();
+    for (size_t i = 0; i <= sliceNames.size(); ++i) {
+        for (; held != regionErrors.end() && held->names == i; ++held) {
+            if (errorHandler) {
+                errorHandler->syntaxError(held->message, held->offset);
+            }
+        }
+        if (i < sliceNames.size()) {
+            checkName(tokens.token(sliceNames[i].first), sliceNames[i].second);
+        }
+    }
+    declaring = declaringAfter;
+    walk(end, tokens.size());
+}
+
+// Find the innermost body that holds tokens [first, end): the Program's, or
+// that of a While whose header is before them, and the statements of it
+// around them. Fills regionBlocks. Returns false if they reach into the
+// Program's header or closing brace.
+bool Parser::findRegion(size_t first, size_t end, Region& region) {
+    region.owner = programNode;
+    region.ownerStart = 0;
+    size_t bodyStart, close;
+    bodyTokens(region.owner, region.ownerStart, bodyStart, close);
+    if (first < bodyStart || end > close) {
+        return false;
+    }
+    regionBlocks.clear();
+    
+    for (;;) {
+        regionBlocks.push_back(region.owner);
+        const AstNode& owner = ast.node(region.owner);
+        region.previous = Ast::npos;
+        region.listStart = bodyStart;
+        
+        // Statement positions add up from the body's start
+        uint32_t next = owner.kind == AstKind::PROGRAM ? owner.first : owner.second;
+        size_t position = bodyStart + (next != Ast::npos ? ast.span(next).offset : 0);
+        while (next != Ast::npos && position + ast.span(next).length <= first) {
+            region.previous = next;
+            region.listStart = position;
+            next = ast.node(next).next;
+            if (next != Ast::npos) {
+                position += ast.span(next).offset;
+            }
+        }
+        region.start = region.previous != Ast::npos ? region.listStart + ast.span(region.previous).length : bodyStart;
+        
+        if (next != Ast::npos && ast.node(next).kind == AstKind::WHILE && position < first) {
+            bodyTokens(next, position, bodyStart, close);
+            if (bodyStart <= first && end <= close) {
+                region.owner = next;
+                region.ownerStart = position;
+                continue;
+            }
+        }
+        
+        while (next != Ast::npos && position < end) {
+            next = ast.node(next).next;
+            if (next != Ast::npos) {
+                position += ast.span(next).offset;
+            }
+        }
+        region.after = next;
+        region.afterStart = position;
+        return true;
+    }
+}
+
+// Update the tree after the lexer's last edit
+bool Parser::reparse() {
+    // Replaced nodes stay in the arena until the next full parse, which
+    // happens once they make up half of it
+    if (!incremental || programNode == Ast::npos || ast.size() > 2 * fullParseNodes) {
+        return parseInFull();
+    }
+    
+    // Damaged tokens in the old numbering, with any an earlier reparse left
+    const TokenEdit& edit = lexer->getLastEdit();
+    size_t first = edit.first;
+    size_t end = edit.first + edit.removed;
+    if (pendingFirst < pendingEnd) {
+        first = std::min(first, pendingFirst);
+        end = std::max(end, pendingEnd);
+    }
+    Region region;
+    if (!findRegion(first, end, region)) {
+        return parseInFull();
+    }
+    
+    // Renumber: the blocks around the damage and the offsets of the
+    // statements after them are all that changes
+    int64_t delta = static_cast<int64_t>(edit.inserted) - static_cast<int64_t>(edit.removed);
+    for (uint32_t block : regionBlocks) {
+        ast.span(block).length = static_cast<uint32_t>(ast.span(block).length + delta);
+        uint32_t next = ast.node(block).next;
+        if (block != programNode && next != Ast::npos) {
+            ast.span(next).offset = static_cast<uint32_t>(ast.span(next).offset + delta);
+        }
+    }
+    size_t damageEnd = static_cast<size_t>(static_cast<int64_t>(end) + delta);
+    region.afterStart = static_cast<size_t>(static_cast<int64_t>(region.afterStart) + delta);
+    
+    // Traces describe whole parses
+    TraceLevel level = traceLevel;
+    std::shared_ptr<ParseTraceRecorder> traceRecorder = std::move(recorder);
+    traceLevel = TraceLevel::NONE;
+    recorder = nullptr;
+    
+    bool fits = false;
+    for (;;) {
+        resumeFrom = damageEnd;
+        if (parseRegion(region)) {
+            fits = true;
+            break;
+        }
+        
+        // The edit changed where the body ends: reparse the While around it
+        // in its own list
+        if (region.owner == programNode) break;
+        first = std::min(first, region.ownerStart);
+        damageEnd = std::max<size_t>(damageEnd, region.ownerStart + ast.span(region.owner).length);
+        if (!findRegion(first, damageEnd, region)) break;
+    }
+    
+    traceLevel = level;
+    recorder = std::move(traceRecorder);
+    if (!fits) {
+        return parseInFull();
+    }
+    
+    // The rest of the input has no syntax errors, so the reparse's are all
+    // there are; the names are checked again around them
+    if (errorHandler) {
+        errorHandler->clear(ErrorType::SYNTAX_ERROR);
+        errorHandler->clear(ErrorType::SEMANTIC_ERROR);
+    }
+    recheckNames(lastReparse.firstToken, lastReparse.firstToken + lastReparse.tokens, isInDeclaration);
+    if (!buildAst) {
+        // No tree until these tokens parse
+        pendingFirst = lastReparse.firstToken;
+        pendingEnd = lastReparse.firstToken + lastReparse.tokens;
+        ast.setRoot(Ast::npos);
+        return false;
+    }
+    pendingFirst = pendingEnd = 0;
+    ast.setRoot(programNode);
+    return true;
+}
+
+// Get the tokens parsed by the last reparse
+const ReparseRegion& Parser::getLastReparse() const {
+    return lastReparse;
+}
+
 // Advance to next token
 void Parser::advance() {
-    currentToken = lexer->getNextToken();
+    currentToken = sliceTokens ? sliceTokens->token(tokensRead) : lexer->getNextToken();
+    tokenIndex = tokensRead++;
+    if (recorder) {
+        recorder->recordToken(static_cast<uint8_t>(currentToken.type));
+    }
 }
 
 // Helper method to convert token to the string used in the parse table
 std::string Parser::tokenToString(const Token& token) const {
-    // Keywords are represented by their lexeme
-    if (token.lexeme == "int" || token.lexeme == "float" || 
-        token.lexeme == "main" || token.lexeme == "while" ||
-        token.lexeme == ";" || token.lexeme == "," ||
-        token.lexeme == "(" || token.lexeme == ")" ||
-        token.lexeme == "{" || token.lexeme == "}" ||
-        token.lexeme == "=" || token.lexeme == "<" ||
-        token.lexeme == ">" || token.lexeme == "++" ||
-        token.lexeme == "--" || token.lexeme == "+" ||
-        token.lexeme == "-" || token.lexeme == "*" ||
-        token.lexeme == "/") {
-        return token.lexeme;
-    }
-    
-    // Convert IDENTIFIER to ID to match grammar
-    if (token.type == TokenType::IDENTIFIER) {
-        return "ID";
-    }
-    
-    // Convert literals to CONST to match grammar
-    if (token.type == TokenType::INTEGER_LITERAL || 
-        token.type == TokenType::FLOAT_LITERAL) {
-        return "CONST";
-    }
-    
-    // Other tokens are represented by their type
-    return token.getTypeAsString();
-} 
\ No newline at end of file
+    return tokenName(token.type);
+}
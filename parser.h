@@ -4,17 +4,35 @@
 #include "lexer.h"
 #include "symbol_table.h"
 #include "error_handler.h"
+#include "builtin_grammar.h"
+#include "ast.h"
+#include "parse_trace.h"
 #include <string>
 #include <vector>
 #include <map>
 #include <set>
 #include <memory>
-#include <stack>
 #include <fstream>
+#include <array>
+#include <cstdint>
 
 // Forward declaration
 class Grammar;
 
+// How much of the parse the parser records, from least to most
+enum class TraceLevel {
+    NONE,    // Nothing: the parse loop does no tracing work at all
+    STAGES,  // The parsing stages table (output/parsing_stages.txt)
+    DEBUG    // The stages table plus DEBUG lines on stdout (unless compiled out)
+};
+
+// What the last Parser::reparse parsed again
+struct ReparseRegion {
+    bool full = false;       // The whole input (no usable tree, or the edit changed its blocks)
+    size_t firstToken = 0;   // Tokens [firstToken, firstToken + tokens) were parsed
+    size_t tokens = 0;
+};
+
 // LL(1) Parser class
 class Parser {
 private:
@@ -23,11 +41,142 @@ private:
     std::shared_ptr<ErrorHandler> errorHandler;
     std::shared_ptr<Grammar> grammar;
     
-    // Parse table: [non-terminal][terminal] -> production index
-    std::map<std::string, std::map<std::string, int>> parseTable;
+    // Grammar symbols are numbered when the table is built: non-terminal i
+    // of grammar->getNonTerminals() is symbol i, and terminal j of
+    // grammar->getTerminals() is symbol terminalBit | j. The built-in
+    // grammar's push sequences also hold semantic actions (actionBit | action).
+    static constexpr uint16_t terminalBit = BuiltinGrammar::terminalBit;
+    static constexpr uint16_t actionBit = BuiltinGrammar::actionBit;
+    static constexpr uint16_t noSymbol = 0xFFFF;   // Matches no grammar symbol
+    static_assert(terminalBit == TraceGrammar::terminalBit && actionBit == TraceGrammar::actionBit &&
+                  noSymbol == TraceGrammar::noSymbol, "Binary traces number symbols as the parser does");
+    size_t nonTerminalCount;
+    size_t terminalCount;
+    std::vector<std::string> nonTerminalNames;
+    std::vector<std::string> terminalNames;
+    std::map<std::string, uint16_t> symbolIds;     // Only used while building
+    
+    // Parse table: production index of [non-terminal][terminal], or -1,
+    // stored row by row (terminalCount entries per non-terminal)
+    std::vector<int16_t> parseTable;
+    
+    // Right side of every production as symbol ids, reversed and without ε,
+    // so that an expansion is one copy onto the stack. Production p is
+    // pushSymbols[pushStart[p]] up to pushSymbols[pushStart[p + 1]].
+    std::vector<uint16_t> pushSymbols;
+    std::vector<uint32_t> pushStart;
+    
+    // Terminal each TokenType matches, or noSymbol
+    static constexpr size_t tokenTypeCount = static_cast<size_t>(TokenType::ERROR) + 1;
+    std::array<uint16_t, tokenTypeCount> tokenTerminals;
+    
+    // Symbol ids the parse loop checks for
+    uint16_t endMarkerId;
+    uint16_t intId;
+    uint16_t floatId;
+    uint16_t semicolonId;
+    uint16_t stmtsId;        // Statement list that recovery restarts at after a ';'
+    
+    // FOLLOW set of every non-terminal for error recovery: one flag per
+    // terminal, laid out like parseTable
+    std::vector<uint8_t> followTable;
+    
+    // Stack for parsing: symbol ids, top at the back. The capacity is kept
+    // across parses, so it stops allocating once it has grown.
+    std::vector<uint16_t> parseStack;
+    
+    // Syntax tree built by the semantic actions (built-in grammar only)
+    Ast ast;
+    bool buildAst;
+    std::vector<uint32_t> values;       // Nodes and operator TokenTypes awaiting an action
+    // A block being parsed: its first and last statement, and the first
+    // token of the last one (of the body while it is empty), which the
+    // span of the next statement counts from
+    struct OpenList {
+        uint32_t first;
+        uint32_t last;
+        uint32_t lastStart;
+    };
+    std::vector<OpenList> openLists;
+    uint32_t openDecl;                  // First Decl node of the declaration being parsed
+    
+    // Incremental reparsing (see reparse). The tree keeps an AstSpan per
+    // node; a reparse parses one statement list from a statement boundary,
+    // on the stack the full parse has there, and stops at the first later
+    // boundary where an old statement of the list starts (the stack is the
+    // same there, so the rest is reused).
+    bool incremental;
+    bool regionParse;        // A reparse is running: names are recorded, errors are held
+    uint32_t programNode;    // Root of the kept tree, or npos if there is none
+    size_t fullParseNodes;   // Tree size after the last full parse
+    uint32_t regionDepth;    // Depth of the statements of the list being reparsed
+    uint32_t resumeCandidate;  // Next old statement of that list
+    size_t resumePosition;   // Its first token
+    size_t resumeFrom;       // Old statements starting here or later can be reused
+    bool resumed;
+    size_t pendingFirst;     // Tokens a reparse with errors left out of the tree
+    size_t pendingEnd;
+    // A syntax error a reparse holds, and how many names it had recorded before it
+    struct HeldError {
+        std::string message;
+        size_t offset;
+        size_t names;
+    };
+    std::vector<HeldError> regionErrors;
+    std::vector<uint32_t> regionBlocks;  // Blocks around the last region found, outermost first
+    ReparseRegion lastReparse;
+    
+    // Statements of one block around some damaged tokens (see findRegion)
+    struct Region {
+        uint32_t owner;      // Program or While whose body holds them
+        size_t ownerStart;   // First token of the owner
+        uint32_t previous;   // Last statement before them, or npos
+        size_t listStart;    // First token of previous, or of the body
+        size_t start;        // First token to parse: the end of previous, or of the body
+        uint32_t after;      // First statement starting at or after their end, or npos
+        size_t afterStart;
+    };
+    
+    // Parallel parsing (see setThreadCount). Each worker is a Parser of its
+    // own that parses one slice of the Program's statements into its own
+    // tree, and only records the names it matches: parseInParallel checks
+    // them and joins the trees in source order.
+    unsigned threadCount;
+    size_t parallelMinTokens;
+    bool sliceParse;                 // This is a worker: names are recorded, a syntax error stops it
+    size_t sliceEnd;                 // Token its slice ends at (SIZE_MAX if not a worker)
+    const TokenStore* sliceTokens;   // Tokens a worker reads, instead of the lexer's stream
+    std::vector<std::pair<uint32_t, bool>> sliceNames;  // Token index of each name matched, and if declared
+                                                         // (also those of a reparse)
+    size_t listFloor;                // Stack size below the statement list a worker or a reparse parses
+    
+    // Error recovery: parsing continues after a syntax error until the
+    // budget of reported errors is used up (0 = no limit). Errors within
+    // the first few tokens after a recovery are not reported, since they
+    // are usually caused by it.
+    static constexpr size_t defaultErrorBudget = 100;
+    static constexpr size_t recoveryQuietTokens = 3;
+    size_t errorBudget;
+    size_t syntaxErrors;
+    size_t quietTokens;      // Tokens still to match before errors are reported again
+    
+    // Tracing. Every trace call in the parse loop checks the level first,
+    // so nothing (not even the stack rendering) is computed when it is off.
+    TraceLevel traceLevel;
+    
+    // Binary trace of the parse, when a recorder is set: the type of every
+    // token read, and the steps the parse table does not decide
+    std::shared_ptr<ParseTraceRecorder> recorder;
+    uint32_t tokenIndex;     // Index of currentToken in the token stream
+    uint32_t tokensRead;
+    size_t recordedDepth;    // Stack size at the previous record
     
-    // Stack for parsing
-    std::stack<std::string> parseStack;
+    void recordStep(TraceAction action, uint16_t argument) {
+        int16_t delta = static_cast<int16_t>(static_cast<ptrdiff_t>(parseStack.size()) -
+                                             static_cast<ptrdiff_t>(recordedDepth));
+        recordedDepth = parseStack.size();
+        recorder->record({tokenIndex, argument, delta, action, static_cast<uint8_t>(currentToken.type), 0});
+    }
     
     // Current token
     Token currentToken;
@@ -41,22 +190,54 @@ private:
     bool isInDeclaration;  // Track if we're currently processing a declaration
     
     // Helper methods
-    void initParseTable();
-    void addToParseTable(const std::string& nonTerminal, const std::string& terminal, int productionIndex);
-    bool isNonTerminal(const std::string& symbol);
-    void panic();  // Error recovery
+    bool parseTokens();  // Parse the whole input
+    bool runParseLoop();  // The parse loop, on the stack as set up
+    void initParseTable();  // Number the symbols and clear the table
+    bool addToParseTable(uint16_t nonTerminal, uint16_t terminal, int productionIndex);  // False on a conflict
+    uint16_t symbolId(const std::string& name) const;  // noSymbol if unknown
+    const std::string& symbolName(uint16_t symbol) const;
+    static bool isNonTerminal(uint16_t symbol) { return (symbol & (terminalBit | actionBit)) == 0; }
+    uint16_t terminalOf(const Token& token) const { return tokenTerminals[static_cast<size_t>(token.type)]; }
+    bool reportSyntaxError(const std::string& message);  // False once the budget is used up
+    void syntaxError(const std::string& message, size_t offset);  // To the handler, or held during a reparse
+    bool recover();  // Error recovery: false if the input ran out
+    void pushTokenValue(const Token& token);  // Value of a matched terminal for the actions
+    void runAction(uint16_t action);          // Run a BuiltinGrammar::Action
+    void appendStatement(uint32_t node, uint32_t start);  // Add to the innermost open block
     void handleIdentifier(const Token& token);  // Handle identifier tokens based on context
+    void checkName(const Token& token, bool declaring);  // Declare a name, or check that it is declared
+    void setSpan(uint32_t node, uint32_t firstToken, uint32_t endToken);  // Span of a new node
+    void anchorSpans(uint32_t node, uint32_t start);  // Make an expression's spans relative to its statement
+    
+    // Parallel parsing helpers
+    Parser(const Parser& parent, const TokenStore& tokens);  // Worker with the parent's tables
+    bool parseInParallel(bool& accepted);  // False if the input has to be parsed sequentially
+    bool parseSlice(size_t first, size_t end, bool declaring);  // Statements [first, end), on a worker
+    
+    // Incremental reparsing helpers
+    bool parseInFull();  // Full parse, recorded as such in lastReparse
+    void bodyTokens(uint32_t owner, size_t ownerStart, size_t& start, size_t& close) const;  // '{'+1 and '}'
+    bool findRegion(size_t first, size_t end, Region& region);
+    bool resumeHere();   // An old statement of the list starts at the current token
+    bool parseRegion(const Region& region);
+    void recheckNames(size_t first, size_t end, bool declaringAfter);  // Names of the whole input, after a reparse
     
     // Function to write parsing stages to file
     void writeParsingStage(const std::string& stackContent, const std::string& input, 
                           const std::string& production, const std::string& action);
     
-    // Convert stack to string
-    std::string stackToString(std::stack<std::string> s);
+    // Convert the parse stack to string (bottom first)
+    std::string stackToString() const;
+    
+    // Production as text for the parsing stages table
+    std::string productionToString(int index) const;
+    
+    // Symbols and tables of the grammar, for the header of a binary trace
+    TraceGrammar traceGrammar() const;
     
     // Helper method to convert token to the string used in the parse table
     std::string tokenToString(const Token& token) const;
-
+    
 public:
     // Constructor
     Parser(std::shared_ptr<LexicalAnalyzer> lex, 
@@ -80,7 +261,54 @@ public:
     void writeParseTableToFile();
     
     // Get the current token
-    Token getCurrentToken() const;
+    const Token& getCurrentToken() const;
+    
+    // Syntax tree of the last successful parse with the built-in grammar
+    // (its root is Ast::npos otherwise)
+    const Ast& getAst() const;
+    
+    // Trace level (TraceLevel::DEBUG by default)
+    void setTraceLevel(TraceLevel level);
+    
+    // Record every parse step to a binary trace (nullptr to stop); see
+    // trace-render for turning it back into the parsing stages table
+    void setTraceRecorder(std::shared_ptr<ParseTraceRecorder> traceRecorder);
+    
+    // Name of a token type in the parse table ("ID", "+", ...)
+    static const char* tokenName(TokenType type);
+    
+    // Maximum number of syntax errors to report before parsing stops
+    // (0 = no limit)
+    void setErrorBudget(size_t budget);
+    
+    // Number of syntax errors the last parse reported
+    size_t getSyntaxErrorCount() const;
+    
+    // Parse inputs of at least minTokens tokens on this many threads
+    // (built-in grammar, untraced parses only). A pre-pass splits the
+    // Program's statements at top-level ';' and '}', each thread parses a
+    // run of them from `stmts`, and the trees and name checks are joined in
+    // source order. A syntax error in any slice makes the whole input parse
+    // on one thread, so the results are always those of a sequential parse.
+    void setThreadCount(unsigned count, size_t minTokens = 1 << 16);
+    
+    // Incremental mode, for editors (built-in grammar only). parse() keeps
+    // spans on the tree; after each LexicalAnalyzer::applyEdit, reparse()
+    // updates the tree by parsing again only the statements the edit
+    // touched, or the while block around them. The symbol table and the
+    // syntax and semantic errors in the error handler are replaced by
+    // those of the edited input, as a full parse would leave them
+    // (lexical errors are the lexer's).
+    void setIncremental(bool enabled);
+    
+    // Update the tree after the lexer's last edit. Falls back to a full
+    // parse when there is no tree to update, or when the edit reaches
+    // beyond the statement list around it. Returns true if the input
+    // parses without errors.
+    bool reparse();
+    
+    // Tokens parsed again by the last reparse
+    const ReparseRegion& getLastReparse() const;
     
     // Advance to the next token
     void advance();
@@ -0,0 +1,70 @@
+#include "rd_parser.h"
+#include <string>
+
+// Constructor
+RecursiveDescentParser::RecursiveDescentParser(std::shared_ptr<LexicalAnalyzer> lex,
+                                               std::shared_ptr<SymbolTable> symTab,
+                                               std::shared_ptr<ErrorHandler> errHandler)
+    : lexer(lex), symbolTable(symTab), errorHandler(errHandler), isInDeclaration(false) {}
+
+// Parse the input
+bool RecursiveDescentParser::parse() {
+    advance();
+    
+    // The whole input must be the start symbol followed by the end marker
+    return parseStartSymbol() && match(endTerminal);
+}
+
+// Match a terminal
+bool RecursiveDescentParser::match(uint8_t expected) {
+    if (terminal() != expected) {
+        std::string errorMsg = std::string("Syntax error: expected '") + terminalNames[expected] +
+                               "', found '" + std::string(currentToken.lexeme) + "'";
+        if (errorHandler) {
+            errorHandler->syntaxError(errorMsg, currentToken.offset);
+        }
+        return false;
+    }
+    
+    // Track declarations the same way the table-driven parser does
+    if (currentToken.type == TokenType::INT || currentToken.type == TokenType::FLOAT) {
+        isInDeclaration = true;
+    } else if (currentToken.type == TokenType::SEMICOLON) {
+        isInDeclaration = false;
+    } else if (currentToken.type == TokenType::IDENTIFIER) {
+        handleIdentifier(currentToken);
+    }
+    
+    if (expected != endTerminal) {
+        advance();
+    }
+    return true;
+}
+
+// Report a token that starts no production
+bool RecursiveDescentParser::unexpected(const char* nonTerminal) {
+    std::string errorMsg = "Syntax error: unexpected token '" + std::string(currentToken.lexeme) +
+                           "' for non-terminal '" + nonTerminal + "'";
+    if (errorHandler) {
+        errorHandler->syntaxError(errorMsg, currentToken.offset);
+    }
+    return false;
+}
+
+// Advance to the next token
+void RecursiveDescentParser::advance() {
+    currentToken = lexer->getNextToken();
+}
+
+// Handle identifier tokens based on context
+void RecursiveDescentParser::handleIdentifier(const Token& token) {
+    if (isInDeclaration) {
+        // Only insert into symbol table if this is a declaration
+        symbolTable->insert(token.value, token.offset);
+    } else if (!symbolTable->exists(token.value)) {
+        if (errorHandler) {
+            errorHandler->semanticError("Use of undeclared variable '" + std::string(token.lexeme) + "'",
+                                        token.offset);
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef RD_PARSER_H
+#define RD_PARSER_H
+
+#include "lexer.h"
+#include "symbol_table.h"
+#include "error_handler.h"
+#include <cstdint>
+#include <memory>
+
+// Direct-coded recursive-descent parser for the built-in grammar.
+// The rule functions, one per non-terminal, are generated by rdgen from the
+// Grammar and its FIRST/FOLLOW sets (see the rd_parser_rules.cpp target in
+// the Makefile). It accepts and rejects the same inputs as Parser::parse,
+// reports the same first syntax error and does the same symbol table work,
+// but keeps no explicit stack and writes no parsing trace or tree. It stops
+// at the first syntax error instead of recovering.
+class RecursiveDescentParser {
+private:
+    std::shared_ptr<LexicalAnalyzer> lexer;
+    std::shared_ptr<SymbolTable> symbolTable;
+    std::shared_ptr<ErrorHandler> errorHandler;
+    
+    // Current token
+    Token currentToken;
+    
+    // State tracking (as in Parser)
+    bool isInDeclaration;
+    
+    // Generated by rdgen: the rule functions, the terminal each TokenType
+    // matches (noTerminal if none), terminal names for messages and the
+    // terminal of the end of input
+    struct Rules;
+    static constexpr uint8_t noTerminal = 0xFF;
+    static const uint8_t tokenTerminals[];
+    static const char* const terminalNames[];
+    static const uint8_t endTerminal;
+    
+    // Parse the start symbol (generated)
+    bool parseStartSymbol();
+    
+    // Terminal of the current token
+    uint8_t terminal() const { return tokenTerminals[static_cast<size_t>(currentToken.type)]; }
+    
+    // Consume the current token if it is the expected terminal; otherwise
+    // report it and return false
+    bool match(uint8_t expected);
+    
+    // Report a token no production of the non-terminal starts with; returns false
+    bool unexpected(const char* nonTerminal);
+    
+    void advance();
+    void handleIdentifier(const Token& token);  // Handle identifier tokens based on context
+    
+public:
+    // Constructor
+    RecursiveDescentParser(std::shared_ptr<LexicalAnalyzer> lex,
+                           std::shared_ptr<SymbolTable> symTab,
+                           std::shared_ptr<ErrorHandler> errHandler);
+    
+    // Parse the input; stops at the first syntax error
+    bool parse();
+};
+
+#endif // RD_PARSER_H
@@ -0,0 +1,271 @@
+// Recursive-descent parser generator
+//
+// Walks the productions of the built-in Grammar together with its FIRST and
+// FOLLOW sets and writes a direct-coded parser: one function per
+// non-terminal that picks its production with a switch over the current
+// terminal, exactly as the LL(1) table would. A production that ends in its
+// own left side (stmts, id_tail, expr_tail, term_tail) becomes a loop rather
+// than a recursive call, so long statement lists do not grow the C++ stack.
+// The generated file implements the rule functions declared in rd_parser.h.
+//
+// Usage: rdgen <output.cpp>
+
+#include "grammar.h"
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// TokenType enumerators in declaration order, and the grammar terminal each
+// one matches ("" for none). Must follow the enum in lexer.h; the generated
+// file checks the count.
+static const std::vector<std::pair<std::string, std::string>> tokenTypes = {
+    {"INT", "int"}, {"FLOAT", "float"}, {"WHILE", "while"}, {"MAIN", "main"},
+    {"PLUS", "+"}, {"MINUS", "-"}, {"MULTIPLY", "*"}, {"DIVIDE", "/"},
+    {"INCREMENT", "++"}, {"DECREMENT", "--"},
+    {"ASSIGN", "="}, {"LESS_THAN", "<"}, {"GREATER_THAN", ">"},
+    {"SEMICOLON", ";"}, {"COMMA", ","}, {"LEFT_PAREN", "("}, {"RIGHT_PAREN", ")"},
+    {"LEFT_BRACE", "{"}, {"RIGHT_BRACE", "}"},
+    {"IDENTIFIER", "ID"}, {"INTEGER_LITERAL", "CONST"}, {"FLOAT_LITERAL", "CONST"},
+    {"END_OF_FILE", "$"}, {"ERROR", ""}
+};
+
+// Terminals of the generated parser: the grammar's terminals plus the end
+// marker, each with the C++ name of its enumerator
+struct Terminals {
+    std::vector<std::string> names;
+    std::vector<std::string> identifiers;
+    std::map<std::string, size_t> ids;
+
+    void add(const std::string& name) {
+        ids[name] = names.size();
+        names.push_back(name);
+
+        // A terminal matched by one token type is named after it; others
+        // (CONST) by their grammar name
+        std::string identifier;
+        int matches = 0;
+        for (const auto& type : tokenTypes) {
+            if (type.second == name) {
+                identifier = type.first;
+                matches++;
+            }
+        }
+        if (matches != 1) {
+            identifier.clear();
+            for (char c : name) {
+                identifier += std::isalnum(static_cast<unsigned char>(c)) ? std::toupper(c) : '_';
+            }
+        }
+        identifiers.push_back("T_" + identifier);
+    }
+};
+
+// C++ name of a non-terminal's rule function
+static std::string ruleName(const std::string& nonTerminal) {
+    std::string name;
+    for (char c : nonTerminal) {
+        name += std::isalnum(static_cast<unsigned char>(c)) ? c : '_';
+    }
+    return name;
+}
+
+// Escape a terminal name for a C++ string literal
+static std::string quoted(const std::string& text) {
+    std::string result = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') result += '\\';
+        result += c;
+    }
+    return result + "\"";
+}
+
+// Production chosen for every (non-terminal, terminal) pair, or -1.
+// Throws if the grammar is not LL(1).
+static std::vector<std::vector<int>> selectProductions(const Grammar& grammar, const Terminals& terminals) {
+    const auto& nonTerminals = grammar.getNonTerminals();
+    std::map<std::string, size_t> rows;
+    for (size_t i = 0; i < nonTerminals.size(); ++i) {
+        rows[nonTerminals[i].name] = i;
+    }
+
+    std::vector<std::vector<int>> table(nonTerminals.size(), std::vector<int>(terminals.names.size(), -1));
+    const auto& productions = grammar.getProductions();
+    for (size_t p = 0; p < productions.size(); ++p) {
+        const auto& lhs = productions[p].leftSide;
+        std::vector<int>& row = table[rows.at(lhs.name)];
+
+        auto select = [&](const GrammarSymbol& terminal) {
+            int& entry = row[terminals.ids.at(terminal.name)];
+            if (entry >= 0 && entry != static_cast<int>(p)) {
+                throw std::runtime_error("Grammar is not LL(1): conflict for [" + lhs.name + ", " +
+                                         terminal.name + "]");
+            }
+            entry = static_cast<int>(p);
+        };
+
+        for (const auto& terminal : grammar.getFirstSetOfSequence(productions[p].rightSide)) {
+            if (terminal.name == "ε") {
+                for (const auto& follow : grammar.getFollowSet(lhs)) {
+                    select(follow);
+                }
+            } else {
+                select(terminal);
+            }
+        }
+    }
+    return table;
+}
+
+static void writeParser(const std::string& filename, const Grammar& grammar, const Terminals& terminals,
+                        const std::vector<std::vector<int>>& table) {
+    std::ofstream out(filename);
+    if (!out.is_open()) throw std::runtime_error("Could not open file " + filename + " for writing");
+
+    const auto& nonTerminals = grammar.getNonTerminals();
+    const auto& productions = grammar.getProductions();
+
+    out << "// Generated by rdgen from the built-in grammar. Do not edit.\n";
+    out << "// Non-terminals: " << nonTerminals.size() << ", terminals: " << terminals.names.size()
+        << ", productions: " << productions.size() << "\n\n";
+    out << "#include \"rd_parser.h\"\n\n";
+
+    // Terminal ids
+    out << "namespace {\n\n";
+    out << "enum Terminal : uint8_t {\n";
+    for (size_t t = 0; t < terminals.names.size(); ++t) {
+        out << "    " << terminals.identifiers[t] << ",  // " << terminals.names[t] << "\n";
+    }
+    out << "};\n\n";
+    out << "} // namespace\n\n";
+
+    out << "static_assert(static_cast<size_t>(TokenType::ERROR) + 1 == " << tokenTypes.size()
+        << ", \"rdgen's TokenType list is out of date\");\n\n";
+
+    out << "const uint8_t RecursiveDescentParser::tokenTerminals[] = {\n";
+    for (const auto& type : tokenTypes) {
+        auto it = terminals.ids.find(type.second);
+        out << "    " << (it == terminals.ids.end() ? "noTerminal" : terminals.identifiers[it->second])
+            << ",  // " << type.first << "\n";
+    }
+    out << "};\n\n";
+
+    out << "const char* const RecursiveDescentParser::terminalNames[] = {\n";
+    for (const auto& name : terminals.names) {
+        out << "    " << quoted(name) << ",\n";
+    }
+    out << "};\n\n";
+
+    out << "const uint8_t RecursiveDescentParser::endTerminal = "
+        << terminals.identifiers[terminals.ids.at("$")] << ";\n\n";
+
+    // Rule declarations
+    out << "struct RecursiveDescentParser::Rules {\n";
+    for (const auto& nt : nonTerminals) {
+        out << "    static bool " << ruleName(nt.name) << "(RecursiveDescentParser& p);\n";
+    }
+    out << "};\n\n";
+
+    out << "bool RecursiveDescentParser::parseStartSymbol() {\n";
+    out << "    return Rules::" << ruleName(grammar.getStartSymbol().name) << "(*this);\n";
+    out << "}\n";
+
+    // One function per non-terminal
+    for (size_t n = 0; n < nonTerminals.size(); ++n) {
+        const std::string& name = nonTerminals[n].name;
+
+        // Productions in order, each with the terminals that select it
+        std::vector<std::pair<int, std::vector<size_t>>> cases;
+        for (size_t t = 0; t < terminals.names.size(); ++t) {
+            int p = table[n][t];
+            if (p < 0) continue;
+            auto it = cases.begin();
+            while (it != cases.end() && it->first != p) ++it;
+            if (it == cases.end()) {
+                cases.push_back({p, {}});
+                it = cases.end() - 1;
+            }
+            it->second.push_back(t);
+        }
+
+        bool loops = false;
+        for (const auto& c : cases) {
+            const auto& rhs = productions[c.first].rightSide;
+            if (!rhs.empty() && rhs.back().name == name) loops = true;
+        }
+
+        std::string indent = loops ? "        " : "    ";
+        out << "\nbool RecursiveDescentParser::Rules::" << ruleName(name) << "(RecursiveDescentParser& p) {\n";
+        if (loops) out << "    for (;;) {\n";
+        out << indent << "switch (p.terminal()) {\n";
+        for (const auto& c : cases) {
+            for (size_t t : c.second) {
+                out << indent << "    case " << terminals.identifiers[t] << ":\n";
+            }
+
+            const auto& rhs = productions[c.first].rightSide;
+            out << indent << "        // " << name << " →";
+            for (const auto& symbol : rhs) {
+                out << " " << symbol.name;
+            }
+            out << "\n";
+
+            bool tailCall = false;
+            for (size_t i = 0; i < rhs.size(); ++i) {
+                const auto& symbol = rhs[i];
+                if (symbol.name == "ε") continue;
+                if (i + 1 == rhs.size() && symbol.name == name) {
+                    tailCall = true;
+                } else if (symbol.type == SymbolType::TERMINAL) {
+                    out << indent << "        if (!p.match(" << terminals.identifiers[terminals.ids.at(symbol.name)]
+                        << ")) return false;\n";
+                } else {
+                    out << indent << "        if (!" << ruleName(symbol.name) << "(p)) return false;\n";
+                }
+            }
+            out << indent << "        " << (tailCall ? "continue;" : "return true;") << "\n";
+        }
+        out << indent << "    default:\n";
+        out << indent << "        return p.unexpected(" << quoted(name) << ");\n";
+        out << indent << "}\n";
+        if (loops) out << "    }\n";
+        out << "}\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <output.cpp>" << std::endl;
+        return 1;
+    }
+
+    try {
+        // initializeGrammar prints a debugging line
+        Grammar grammar;
+        std::streambuf* stdoutBuffer = std::cout.rdbuf(nullptr);
+        grammar.initializeGrammar();
+        std::cout.rdbuf(stdoutBuffer);
+
+        Terminals terminals;
+        for (const auto& terminal : grammar.getTerminals()) {
+            if (terminal.name != "ε") terminals.add(terminal.name);
+        }
+        if (terminals.ids.count("$") == 0) {
+            terminals.add("$");
+        }
+
+        auto table = selectProductions(grammar, terminals);
+        writeParser(argv[1], grammar, terminals, table);
+
+        std::cout << "rdgen: " << grammar.getNonTerminals().size() << " rule functions, "
+                  << grammar.getProductions().size() << " productions -> " << argv[1] << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "rdgen: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
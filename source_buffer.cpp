@@ -0,0 +1,97 @@
+#include "source_buffer.h"
+#include <fstream>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Constructor
+SourceBuffer::SourceBuffer(std::string content)
+    : text(std::move(content)), mapped(nullptr), mappedSize(0) {}
+
+// Destructor
+SourceBuffer::~SourceBuffer() {
+    #ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(mapped), mappedSize);
+    }
+    #endif
+}
+
+// Load a file, preferring a memory mapping
+std::shared_ptr<SourceBuffer> SourceBuffer::fromFile(const std::string& filename) {
+    #ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size_t size = static_cast<size_t>(info.st_size);
+        void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            close(fd);
+            madvise(address, size, MADV_SEQUENTIAL);
+            
+            auto buffer = std::make_shared<SourceBuffer>();
+            buffer->mapped = static_cast<const char*>(address);
+            buffer->mappedSize = size;
+            return buffer;
+        }
+    }
+    close(fd);
+    #endif
+    
+    // Fallback: read the file in fixed-size chunks
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) return nullptr;
+    
+    std::string content;
+    char chunk[1 << 16];
+    while (file.read(chunk, sizeof(chunk)) || file.gcount() > 0) {
+        content.append(chunk, static_cast<size_t>(file.gcount()));
+    }
+    return std::make_shared<SourceBuffer>(std::move(content));
+}
+
+// Check for a memory mapping
+bool SourceBuffer::isMapped() const {
+    return mapped != nullptr;
+}
+
+// Raw data pointer
+const char* SourceBuffer::data() const {
+    return mapped ? mapped : text.data();
+}
+
+// Size in bytes
+size_t SourceBuffer::size() const {
+    return mapped ? mappedSize : text.size();
+}
+
+// View of the whole buffer
+std::string_view SourceBuffer::view() const {
+    return std::string_view(data(), size());
+}
+
+// View of a range of the buffer
+std::string_view SourceBuffer::slice(size_t offset, size_t length) const {
+    return view().substr(offset, length);
+}
+
+// Edit the buffer in place
+void SourceBuffer::replace(size_t offset, size_t length, std::string_view replacement) {
+    #ifndef _WIN32
+    if (mapped) {
+        text.assign(mapped, mappedSize);
+        munmap(const_cast<char*>(mapped), mappedSize);
+        mapped = nullptr;
+        mappedSize = 0;
+    }
+    #endif
+    
+    text.replace(offset, length, replacement.data(), replacement.size());
+}
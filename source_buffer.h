@@ -0,0 +1,51 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Source text of one compilation.
+// Token lexemes are views into this buffer, so it must outlive every token
+// produced from it; the lexer keeps it alive through a shared_ptr.
+// Files are memory-mapped read-only where the platform allows it, so the
+// text is never copied onto the heap.
+class SourceBuffer {
+private:
+    std::string text;              // Owned copy (strings and read fallback)
+    const char* mapped;            // Mapped file contents, or nullptr
+    size_t mappedSize;
+    
+public:
+    // Constructor (takes ownership of the text)
+    explicit SourceBuffer(std::string content = "");
+    
+    // Destructor (unmaps the file, if mapped)
+    ~SourceBuffer();
+    
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+    
+    // Map a file with MAP_PRIVATE and sequential access advice, falling back
+    // to reading it in chunks. Returns nullptr if the file cannot be opened.
+    static std::shared_ptr<SourceBuffer> fromFile(const std::string& filename);
+    
+    // True if the contents are memory-mapped
+    bool isMapped() const;
+    
+    // Raw access
+    const char* data() const;
+    size_t size() const;
+    
+    // View of the whole buffer
+    std::string_view view() const;
+    
+    // View of [offset, offset + length)
+    std::string_view slice(size_t offset, size_t length) const;
+    
+    // Replace [offset, offset + length) with new text. A mapped file is
+    // copied into memory first. Invalidates all views into the buffer.
+    void replace(size_t offset, size_t length, std::string_view replacement);
+};
+
+#endif // SOURCE_BUFFER_H
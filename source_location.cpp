@@ -0,0 +1,85 @@
+#include "source_location.h"
+#include <algorithm>
+
+// Constructor
+LineIndex::LineIndex() : base(0), firstLine(1), lineStarts(1, 0), lastLine(0) {}
+
+// Reset to a single line starting at offset 0
+void LineIndex::clear() {
+    base = 0;
+    firstLine = 1;
+    lineStarts.assign(1, 0);
+    lastLine = 0;
+}
+
+// Record a new line
+void LineIndex::addLineStart(size_t offset) {
+    lineStarts.push_back(static_cast<uint32_t>(offset - base));
+}
+
+// Append lines recorded by another index (e.g. one lexer thread's chunk)
+void LineIndex::append(const LineIndex& other) {
+    size_t last = base + lineStarts.back();
+    for (uint32_t start : other.lineStarts) {
+        size_t offset = other.base + start;
+        if (offset > last) {
+            lineStarts.push_back(static_cast<uint32_t>(offset - base));
+        }
+    }
+}
+
+// Cut the index after an offset
+std::vector<size_t> LineIndex::splitAfter(size_t offset) {
+    std::vector<size_t> tail;
+    size_t keep = find(offset > base ? offset - base : 0) + 1;
+    for (size_t i = keep; i < lineStarts.size(); ++i) {
+        tail.push_back(base + lineStarts[i]);
+    }
+    lineStarts.resize(keep);
+    lastLine = 0;
+    return tail;
+}
+
+// Drop lines before the one containing offset
+void LineIndex::discardBefore(size_t offset) {
+    if (offset <= base) return;
+    
+    size_t keep = find(offset - base);
+    if (keep == 0) return;
+    
+    uint32_t shift = lineStarts[keep];
+    lineStarts.erase(lineStarts.begin(), lineStarts.begin() + keep);
+    for (uint32_t& start : lineStarts) {
+        start -= shift;
+    }
+    base += shift;
+    firstLine += static_cast<int>(keep);
+    lastLine = 0;
+}
+
+// Number of lines seen
+size_t LineIndex::lineCount() const {
+    return static_cast<size_t>(firstLine - 1) + lineStarts.size();
+}
+
+// Find the line containing a base-relative offset
+size_t LineIndex::find(size_t relative) const {
+    // Try the line of the previous lookup and the one after it first
+    for (size_t i = lastLine; i < lineStarts.size() && i < lastLine + 2; ++i) {
+        if (lineStarts[i] <= relative && (i + 1 == lineStarts.size() || relative < lineStarts[i + 1])) {
+            return lastLine = i;
+        }
+    }
+    
+    auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), relative);
+    return lastLine = static_cast<size_t>(it - lineStarts.begin()) - 1;
+}
+
+// Resolve an offset to line and column
+SourceLocation LineIndex::resolve(size_t offset) const {
+    // Offsets behind the kept lines resolve to the first kept line
+    size_t relative = offset > base ? offset - base : 0;
+    size_t index = find(relative);
+    return SourceLocation(firstLine + static_cast<int>(index),
+                          static_cast<int>(relative - lineStarts[index]) + 1);
+}
@@ -0,0 +1,69 @@
+#ifndef SOURCE_LOCATION_H
+#define SOURCE_LOCATION_H
+
+#include "lexer_simd.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One-based line and column of a byte in the source
+struct SourceLocation {
+    int line;
+    int column;
+    
+    SourceLocation(int ln = 0, int col = 0) : line(ln), column(col) {}
+};
+
+// Start offset of every line of a source, filled in by the lexer as it
+// skips newlines. Tokens, errors and symbols carry only byte offsets; this
+// turns an offset into a line and column when something is reported.
+class LineIndex {
+private:
+    // Offsets are stored relative to base, and lineStarts[0] belongs to
+    // line firstLine. Streaming drops lines behind the window, which moves
+    // both forward and keeps the index small.
+    size_t base;
+    int firstLine;
+    std::vector<uint32_t> lineStarts;
+    
+    // Line found by the previous lookup (lookups are mostly in order)
+    mutable size_t lastLine;
+    
+    // Index into lineStarts of the line containing a base-relative offset
+    size_t find(size_t relative) const;
+    
+public:
+    // Constructor (an index holding just line 1)
+    LineIndex();
+    
+    // Forget all lines but the first
+    void clear();
+    
+    // Record a line starting at an absolute offset (after the last one)
+    void addLineStart(size_t offset);
+    
+    // Let a SIMD kernel append the newlines it passes over, for a buffer
+    // whose first byte is at absolute offset bufferOffset
+    void attach(LexerSimd::NewlineCount& newlines, const char* buffer, size_t bufferOffset) {
+        newlines.lineStarts = &lineStarts;
+        newlines.origin = buffer;
+        newlines.bias = static_cast<uint32_t>(bufferOffset - base);
+    }
+    
+    // Append the lines of another index that start after our last one
+    void append(const LineIndex& other);
+    
+    // Remove and return the (absolute) starts of lines beginning after offset
+    std::vector<size_t> splitAfter(size_t offset);
+    
+    // Drop lines that end before an absolute offset
+    void discardBefore(size_t offset);
+    
+    // Number of lines recorded so far (including dropped ones)
+    size_t lineCount() const;
+    
+    // Line and column of an absolute offset
+    SourceLocation resolve(size_t offset) const;
+};
+
+#endif // SOURCE_LOCATION_H
@@ -1,45 +1,79 @@
 #include "symbol_table.h"
 #include "error_handler.h"
+#include "source_location.h"
+#include "interner.h"
 #include <iostream>
 #include <fstream>
 #include <filesystem>
 
 // Constructor
 SymbolTable::SymbolTable(std::shared_ptr<ErrorHandler> errHandler)
-    : errorHandler(errHandler), nextSerialNo(1) {}
+    : interner(std::make_shared<Interner>()), errorHandler(errHandler), nextSerialNo(1) {}
 
 // Set error handler
 void SymbolTable::setErrorHandler(std::shared_ptr<ErrorHandler> errHandler) {
     errorHandler = errHandler;
 }
 
-// Insert a symbol
-bool SymbolTable::insert(const std::string& name, int line, int column) {
+// Set line index
+void SymbolTable::setLineIndex(std::shared_ptr<const LineIndex> index) {
+    lineIndex = index;
+}
+
+// Get the interner
+std::shared_ptr<Interner> SymbolTable::getInterner() const {
+    return interner;
+}
+
+// Insert a symbol by name id
+bool SymbolTable::insert(uint32_t id, size_t offset) {
     // Check if symbol already exists
-    if (exists(name)) {
+    if (exists(id)) {
         if (errorHandler) {
-            errorHandler->semanticError("Symbol '" + name + "' already declared", line, column);
+            errorHandler->semanticError("Symbol '" + std::string(interner->name(id)) + "' already declared", offset);
         }
         return false;
     }
     
     // Create and insert new symbol with serial number
-    symbols[name] = std::make_shared<Symbol>(nextSerialNo++, name, line, column);
+    if (id >= symbols.size()) {
+        symbols.resize(interner->size());
+    }
+    symbols[id] = std::make_shared<Symbol>(nextSerialNo++, id, std::string(interner->name(id)), offset);
+    declared.push_back(id);
     return true;
 }
 
-// Lookup a symbol
-std::shared_ptr<Symbol> SymbolTable::lookup(const std::string& name) const {
-    auto it = symbols.find(name);
-    if (it != symbols.end()) {
-        return it->second;
-    }
-    return nullptr;
+// Insert a symbol by name
+bool SymbolTable::insert(std::string_view name, size_t offset) {
+    return insert(interner->intern(name), offset);
+}
+
+// Lookup a symbol by name id
+std::shared_ptr<Symbol> SymbolTable::lookup(uint32_t id) const {
+    return id < symbols.size() ? symbols[id] : nullptr;
+}
+
+// Lookup a symbol by name
+std::shared_ptr<Symbol> SymbolTable::lookup(std::string_view name) const {
+    uint32_t id = interner->find(name);
+    return id != Interner::npos ? lookup(id) : nullptr;
 }
 
 // Check if symbol exists
-bool SymbolTable::exists(const std::string& name) const {
-    return symbols.find(name) != symbols.end();
+bool SymbolTable::exists(uint32_t id) const {
+    return id < symbols.size() && symbols[id] != nullptr;
+}
+
+// Check if symbol exists by name
+bool SymbolTable::exists(std::string_view name) const {
+    uint32_t id = interner->find(name);
+    return id != Interner::npos && exists(id);
+}
+
+// Resolve a symbol's declaration offset
+SourceLocation SymbolTable::locationOf(const Symbol& symbol) const {
+    return lineIndex ? lineIndex->resolve(symbol.offset) : SourceLocation();
 }
 
 // Print the symbol table (for debugging)
@@ -47,12 +81,13 @@ void SymbolTable::print() const {
     std::cout << "Symbol Table:" << std::endl;
     std::cout << "------------" << std::endl;
     
-    for (const auto& pair : symbols) {
-        const auto& symbol = pair.second;
+    for (uint32_t id : declared) {
+        const auto& symbol = symbols[id];
+        SourceLocation location = locationOf(*symbol);
         std::cout << "Serial No: " << symbol->serialNo
                   << ", Name: " << symbol->name 
-                  << ", Line: " << symbol->line
-                  << ", Column: " << symbol->column
+                  << ", Line: " << location.line
+                  << ", Column: " << location.column
                   << std::endl;
     }
 }
@@ -74,20 +109,21 @@ void SymbolTable::writeToFile(const std::string& filename) const {
     file << "Serial No,Name,Line,Column\n";
     
     // Write symbol entries
-    for (const auto& pair : symbols) {
-        const auto& symbol = pair.second;
+    for (uint32_t id : declared) {
+        const auto& symbol = symbols[id];
+        SourceLocation location = locationOf(*symbol);
         file << symbol->serialNo << ","
              << symbol->name << ","
-             << symbol->line << ","
-             << symbol->column << "\n";
+             << location.line << ","
+             << location.column << "\n";
     }
 }
 
 // Get all symbols
 std::vector<std::shared_ptr<Symbol>> SymbolTable::getAllSymbols() const {
     std::vector<std::shared_ptr<Symbol>> result;
-    for (const auto& pair : symbols) {
-        result.push_back(pair.second);
+    for (uint32_t id : declared) {
+        result.push_back(symbols[id]);
     }
     return result;
 }
@@ -95,5 +131,6 @@ std::vector<std::shared_ptr<Symbol>> SymbolTable::getAllSymbols() const {
 // Clear the symbol table
 void SymbolTable::clear() {
     symbols.clear();
+    declared.clear();
     nextSerialNo = 1;
 } 
\ No newline at end of file
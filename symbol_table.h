@@ -2,34 +2,46 @@
 #define SYMBOL_TABLE_H
 
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <cstdint>
 
-// Forward declaration
+// Forward declarations
 class ErrorHandler;
+class Interner;
+class LineIndex;
+struct SourceLocation;
 
 // Symbol entry in the symbol table
 struct Symbol {
     int serialNo;        // Serial number for the symbol
+    uint32_t id;         // Interned name id
     std::string name;    // Symbol name
-    int line;           // Line number in source
-    int column;         // Column number in source
+    size_t offset;       // Byte offset of the declaration in the source
     
     // Constructor
-    Symbol(int sn, const std::string& n, int l, int c)
-        : serialNo(sn), name(n), line(l), column(c) {}
+    Symbol(int sn, uint32_t i, const std::string& n, size_t off)
+        : serialNo(sn), id(i), name(n), offset(off) {}
 };
 
 // Symbol Table class
 class SymbolTable {
 private:
-    // Main hash table using identifier names as keys
-    std::unordered_map<std::string, std::shared_ptr<Symbol>> symbols;
+    // Names are interned once (by the lexer), and symbols are indexed
+    // directly by name id; entries for undeclared names are null
+    std::shared_ptr<Interner> interner;
+    std::vector<std::shared_ptr<Symbol>> symbols;
+    
+    // Ids in declaration order, for output
+    std::vector<uint32_t> declared;
     
     // Error handler reference
     std::shared_ptr<ErrorHandler> errorHandler;
     
+    // Resolves declaration offsets when the table is printed or written
+    std::shared_ptr<const LineIndex> lineIndex;
+    
     // Serial number counter
     int nextSerialNo;
     
@@ -40,14 +52,26 @@ public:
     // Set error handler
     void setErrorHandler(std::shared_ptr<ErrorHandler> errHandler);
     
-    // Insert a symbol
-    bool insert(const std::string& name, int line, int column);
+    // Set the line index used to resolve offsets (the lexer sets its own)
+    void setLineIndex(std::shared_ptr<const LineIndex> index);
+    
+    // Interner whose ids index this table (the lexer interns into it)
+    std::shared_ptr<Interner> getInterner() const;
+    
+    // Insert a symbol declared at a source offset
+    bool insert(uint32_t id, size_t offset);
+    bool insert(std::string_view name, size_t offset);
+    
+    // Line and column of a symbol's declaration
+    SourceLocation locationOf(const Symbol& symbol) const;
     
     // Lookup a symbol
-    std::shared_ptr<Symbol> lookup(const std::string& name) const;
+    std::shared_ptr<Symbol> lookup(uint32_t id) const;
+    std::shared_ptr<Symbol> lookup(std::string_view name) const;
     
     // Check if symbol exists
-    bool exists(const std::string& name) const;
+    bool exists(uint32_t id) const;
+    bool exists(std::string_view name) const;
     
     // Print the symbol table (for debugging)
     void print() const;
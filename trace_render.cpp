@@ -0,0 +1,234 @@
+// Parse trace renderer
+//
+// Rebuilds the parsing stages table (the format of output/parsing_stages.txt)
+// from a binary trace recorded with --trace-file. The stack is replayed
+// from the first record, but only the requested rows are turned into text,
+// so looking at a window of a huge trace stays cheap. Matches and
+// expansions are not recorded; their rows are replayed with the parse
+// table stored in the trace, from the stack and the recorded token types,
+// so traces of any grammar render.
+//
+// Usage: trace-render <trace.bin> [first_row [row_count]]
+
+#include "parse_trace.h"
+#include "parser.h"
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint16_t terminalBit = TraceGrammar::terminalBit;
+constexpr uint16_t actionBit = TraceGrammar::actionBit;
+constexpr uint16_t noSymbol = TraceGrammar::noSymbol;
+
+// Name of a symbol of the traced grammar
+const std::string& symbolName(const TraceGrammar& grammar, uint16_t symbol) {
+    return (symbol & terminalBit) ? grammar.terminalNames[symbol & ~terminalBit] : grammar.nonTerminalNames[symbol];
+}
+
+// Stack as Parser::stackToString writes it (bottom first, no actions)
+std::string stackToString(const TraceGrammar& grammar, const std::vector<uint16_t>& stack) {
+    if (stack.empty()) return "ε";
+
+    std::string result;
+    for (uint16_t symbol : stack) {
+        if (symbol & actionBit) continue;
+        result += symbolName(grammar, symbol);
+        result += ' ';
+    }
+    if (!result.empty()) {
+        result.pop_back();
+    }
+    return result;
+}
+
+// Text of a row
+std::string renderRow(const TraceGrammar& grammar, const TraceRecord& step, const std::vector<uint16_t>& stack,
+                      size_t errorRecordToken) {
+    std::string input = Parser::tokenName(static_cast<TokenType>(step.tokenType));
+    std::string stackText = stackToString(grammar, stack);
+    std::string production;
+    std::string action;
+
+    switch (step.action) {
+        case TraceAction::START:
+            action = "Initial stack setup";
+            break;
+        case TraceAction::MISMATCH:
+            action = "ERROR: Terminal mismatch";
+            break;
+        case TraceAction::NO_PRODUCTION:
+            action = "ERROR: No matching production";
+            break;
+        case TraceAction::BUDGET:
+            action = "Error budget used up";
+            break;
+        case TraceAction::RESUME:
+            action = "Resumed parsing after skipping " + std::to_string(step.tokenIndex - errorRecordToken) +
+                     " token(s)";
+            break;
+        case TraceAction::RECOVERY_EOF:
+            action = "Recovery reached end of input";
+            break;
+        case TraceAction::ACCEPT:
+            stackText = input = "$";
+            action = "Accepted";
+            break;
+        case TraceAction::FINISHED:
+            stackText = input = "$";
+            action = "Finished with " + std::to_string(step.argument) + " error(s)";
+            break;
+        case TraceAction::TRAILING:
+            stackText.clear();
+            action = "ERROR: Unexpected token after input";
+            break;
+    }
+    return "| " + stackText + " | " + input + " | " + production + " | " + action + " |";
+}
+
+// Text of a match row
+std::string renderMatch(const TraceGrammar& grammar, uint16_t terminal, TokenType token,
+                        const std::vector<uint16_t>& stack) {
+    return "| " + stackToString(grammar, stack) + " | " + Parser::tokenName(token) + " |  | Match: " +
+           symbolName(grammar, terminal) + " |";
+}
+
+// Text of an expansion row
+std::string renderExpand(const TraceGrammar& grammar, int production, TokenType token,
+                         const std::vector<uint16_t>& stack) {
+    return "| " + stackToString(grammar, stack) + " | " + Parser::tokenName(token) + " | " +
+           grammar.productionTexts[production] + " | Expand non-terminal |";
+}
+
+// Pop the semantic actions the parse loop ran
+void popActions(std::vector<uint16_t>& stack) {
+    while (!stack.empty() && (stack.back() & actionBit)) {
+        stack.pop_back();
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " <trace.bin> [first_row [row_count]]" << std::endl;
+        return 1;
+    }
+
+    try {
+        ParseTraceReader reader(argv[1]);
+        const TraceGrammar& grammar = reader.getGrammar();
+        const auto& records = reader.getRecords();
+        const auto& tokens = reader.getTokenTypes();
+        size_t first = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0;
+        size_t count = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : SIZE_MAX;
+        size_t last = first + std::min(count, SIZE_MAX - first);
+
+        const auto& tokenTerminals = grammar.tokenTerminals;
+        size_t terminalCount = grammar.terminalNames.size();
+
+        std::cout << "| Stack Contents | Current Input | Production Used | Action |\n";
+        std::cout << "|---------------|---------------|-----------------|--------|\n";
+
+        // Replay the parse up to the last requested row
+        std::vector<uint16_t> stack;
+        size_t row = 0;
+        size_t position = 0;            // Index of the current token
+        size_t recordedDepth = 0;       // Stack size at the previous record
+        bool recovering = false;        // Between an error and its RESUME
+        size_t errorRecordToken = 0;
+        for (size_t i = 0; i < records.size() && row < last; ++i) {
+            const TraceRecord& step = records[i];
+            auto mismatch = [i]() {
+                return std::runtime_error("record " + std::to_string(i) + " does not match the replayed parse");
+            };
+
+            // The matches and expansions the table decides, up to this record
+            while (step.action != TraceAction::START && !recovering && row < last) {
+                popActions(stack);
+                if (stack.empty()) break;
+                if (position >= tokens.size() || tokens[position] >= tokenTerminals.size()) throw mismatch();
+                TokenType token = static_cast<TokenType>(tokens[position]);
+                uint16_t terminal = tokenTerminals[tokens[position]];
+                uint16_t top = stack.back();
+                if (top == grammar.endMarker && token == TokenType::END_OF_FILE) break;
+
+                if (top & terminalBit) {
+                    if (top != terminal) break;
+                    stack.pop_back();
+                    position++;
+                    if (row++ >= first) {
+                        std::cout << renderMatch(grammar, top, token, stack) << "\n";
+                    }
+                } else {
+                    int production = terminal == noSymbol
+                                         ? -1
+                                         : grammar.parseTable[top * terminalCount + (terminal & ~terminalBit)];
+                    if (production < 0) break;
+                    stack.pop_back();
+                    stack.insert(stack.end(), grammar.pushSymbols.begin() + grammar.pushStart[production],
+                                 grammar.pushSymbols.begin() + grammar.pushStart[production + 1]);
+                    if (row++ >= first) {
+                        std::cout << renderExpand(grammar, production, token, stack) << "\n";
+                    }
+                }
+            }
+            if (row == last) break;
+            if (step.action != TraceAction::START && !recovering && position != step.tokenIndex) {
+                throw mismatch();
+            }
+
+            switch (step.action) {
+                case TraceAction::START:
+                    if (grammar.nonTerminalNames.empty()) throw mismatch();
+                    stack.assign({grammar.endMarker, grammar.startSymbol});
+                    recordedDepth = 0;
+                    break;
+                case TraceAction::RESUME:
+                case TraceAction::RECOVERY_EOF:
+                case TraceAction::TRAILING:
+                    // Recovery only cuts the stack
+                    if (step.depthDelta > 0 || recordedDepth < static_cast<size_t>(-step.depthDelta)) {
+                        throw mismatch();
+                    }
+                    stack.resize(recordedDepth + step.depthDelta);
+                    break;
+                case TraceAction::BUDGET:
+                    break;
+                default:
+                    // The step the table did not decide: the failed symbol
+                    // stays on the stack, an accepted $ is popped
+                    popActions(stack);
+                    if (step.action == TraceAction::ACCEPT || step.action == TraceAction::FINISHED) {
+                        if (stack.empty()) throw mismatch();
+                        stack.pop_back();
+                    }
+                    break;
+            }
+
+            if (static_cast<ptrdiff_t>(stack.size()) - static_cast<ptrdiff_t>(recordedDepth) != step.depthDelta) {
+                throw mismatch();
+            }
+            recordedDepth = stack.size();
+            position = step.tokenIndex;
+            recovering = step.action == TraceAction::MISMATCH || step.action == TraceAction::NO_PRODUCTION ||
+                         (recovering && step.action == TraceAction::BUDGET);
+            if (step.action == TraceAction::MISMATCH || step.action == TraceAction::NO_PRODUCTION) {
+                errorRecordToken = step.tokenIndex;
+            }
+
+            if (row++ >= first) {
+                std::cout << renderRow(grammar, step, stack, errorRecordToken) << "\n";
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "trace-render: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}